@@ -0,0 +1,103 @@
+#include "batchdecoder.hpp"
+
+Serialization::BatchDecoder::BatchDecoder(size_t _threads)
+    : workersCount{_threads ? _threads : std::max<size_t>(1, std::thread::hardware_concurrency())},
+      workers{new Worker[workersCount]}, task{nullptr}, generation{0}, busy{0}, stopping{false}
+{
+    // worker 0 is the thread that calls decode()
+    for(size_t i = 1; i < workersCount; ++i) threads.emplace_back(&BatchDecoder::loop, this, i);
+}
+
+Serialization::BatchDecoder::~BatchDecoder()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    started.notify_all();
+    for(auto& thread : threads) thread.join();
+}
+
+void Serialization::BatchDecoder::run(const std::vector<BytesCount>& sizes, const Task& _task)
+{
+    if(sizes.empty()) return;
+    // contiguous parts of about the same number of bytes, every message is counted at least as one byte
+    BytesCount total = 0;
+    for(BytesCount size : sizes) total += size + 1;
+    size_t index = 0;
+    BytesCount done = 0;
+    for(size_t w = 0; w < workersCount; ++w)
+    {
+        std::lock_guard<std::mutex> lock(workers[w].mutex);
+        workers[w].begin = index;
+        BytesCount target = total / workersCount * (w + 1);
+        while(index < sizes.size() && (done < target || w == workersCount - 1)) done += sizes[index++] + 1;
+        workers[w].end = index;
+    }
+    task = &_task;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        busy = workersCount - 1;
+        ++generation;
+    }
+    started.notify_all();
+    work(0);
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return busy == 0; });
+    task = nullptr;
+}
+
+void Serialization::BatchDecoder::work(size_t worker)
+{
+    size_t index;
+    while(next(worker, &index)) (*task)(worker, index);
+}
+
+bool Serialization::BatchDecoder::next(size_t worker, size_t* index)
+{
+    Worker& own = workers[worker];
+    {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(own.begin < own.end)
+        {
+            *index = own.begin++;
+            return true;
+        }
+    }
+    for(size_t k = 1; k < workersCount; ++k)
+    {
+        Worker& victim = workers[(worker + k) % workersCount];
+        size_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if(victim.begin == victim.end) continue;
+            // upper half, victim keeps messages it is going to take next
+            begin = victim.begin + (victim.end - victim.begin) / 2;
+            end = victim.end;
+            victim.end = begin;
+        }
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.begin = begin + 1;
+        own.end = end;
+        *index = begin;
+        return true;
+    }
+    return false;
+}
+
+void Serialization::BatchDecoder::loop(size_t worker)
+{
+    uint64_t seen = 0;
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            started.wait(lock, [this, seen] { return stopping || generation != seen; });
+            if(stopping) return;
+            seen = generation;
+        }
+        work(worker);
+        std::lock_guard<std::mutex> lock(mutex);
+        if(--busy == 0) finished.notify_all();
+    }
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include "serializer.hpp"
+
+namespace Serialization
+{
+    /*
+        Decodes batches of independent messages on a pool of threads.
+        Messages are split between workers by their sizes, worker that finished its part steals half of remaining part of another one,
+        so few big messages don't keep one thread busy while others wait.
+        Every worker has its own buffer, frames that are not std::string are copied there before decoding, because Deserializer
+        and deserialize() of user types read only std::string; the buffer is reused, so the copy doesn't allocate.
+        Every worker also has its own DeserializationContext: targets left over when batch is smaller than the previous one are recycled there,
+        and new targets of a bigger batch are acquired from context of worker that decodes them, so their memory is reused too.
+        Calling thread works too. Only one batch is decoded at a time, concurrent decode() calls wait for each other.
+    */
+    class BatchDecoder
+    {
+    public:
+        // result of decoding one message; error is set if deserializer threw
+        struct Result
+        {
+            BytesCount bytes = 0;
+            std::exception_ptr error;
+
+            inline bool ok() const { return !error; }
+        };
+
+        // 0 threads means one per processor
+        explicit BatchDecoder(size_t threads = 0);
+        ~BatchDecoder();
+
+        BatchDecoder(const BatchDecoder&) = delete;
+        BatchDecoder& operator=(const BatchDecoder&) = delete;
+
+        /*
+            Deserializes buffers[i] into targets[i], 'targets' is resized to number of buffers.
+            Buffers are std::string or frames with data() and size()(std::string_view, for example records of RecordLogReader).
+            Decoding into the same targets again reuses their memory(T must be movable). Results are in order of buffers.
+        */
+        template<typename T, typename Buffer>
+        std::vector<Result> decode(const std::vector<Buffer>& buffers, std::vector<T>& targets);
+
+        inline size_t getThreadsCount() const { return workersCount; }
+
+    private:
+        typedef std::function<void(size_t worker, size_t index)> Task;
+
+        // range of messages that worker has not decoded yet
+        struct alignas(64) Worker
+        {
+            std::mutex mutex;
+            size_t begin = 0;
+            size_t end = 0;
+            std::string buffer;
+            DeserializationContext context;
+        };
+
+        // calls 'task' for every message once, returns when all are done; caller holds runMutex
+        void run(const std::vector<BytesCount>& sizes, const Task& task);
+        void work(size_t worker);
+        bool next(size_t worker, size_t* index);
+        void loop(size_t worker);
+
+        size_t workersCount;
+        std::unique_ptr<Worker[]> workers;
+        std::vector<std::thread> threads;
+        const Task* task;
+        std::mutex runMutex;
+        std::mutex mutex;
+        std::condition_variable started;
+        std::condition_variable finished;
+        uint64_t generation;
+        size_t busy;
+        bool stopping;
+    };
+
+    template<typename T, typename Buffer>
+    std::vector<BatchDecoder::Result> BatchDecoder::decode(const std::vector<Buffer>& buffers, std::vector<T>& targets)
+    {
+        // contexts and buffers of workers are shared by all calls
+        std::lock_guard<std::mutex> runLock(runMutex);
+        // surplus targets keep their memory in contexts of workers
+        for(size_t i = buffers.size(); i < targets.size(); ++i) workers[i % workersCount].context.recycle(std::move(targets[i]));
+        size_t reused = std::min(targets.size(), buffers.size());
+        targets.resize(buffers.size());
+        std::vector<Result> results(buffers.size());
+        std::vector<BytesCount> sizes(buffers.size());
+        for(size_t i = 0; i < buffers.size(); ++i) sizes[i] = buffers[i].size();
+        run(sizes, [this, &buffers, &targets, &results, reused](size_t worker, size_t index)
+        {
+            try
+            {
+                if(index >= reused) targets[index] = workers[worker].context.template acquire<T>();
+                if constexpr(std::is_same<Buffer, std::string>::value)
+                {
+                    results[index].bytes = Deserializer::deserializeAll(buffers[index], 0, &targets[index]);
+                }
+                else
+                {
+                    // Deserializer reads std::string only
+                    std::string& buf = workers[worker].buffer;
+                    buf.assign(buffers[index].data(), buffers[index].size());
+                    results[index].bytes = Deserializer::deserializeAll(buf, 0, &targets[index]);
+                }
+            }
+            catch(...)
+            {
+                results[index].error = std::current_exception();
+            }
+        });
+        return results;
+    }
+}
@@ -0,0 +1,422 @@
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include "serializer.hpp"
+
+namespace Serialization
+{
+    /*
+        Elements sorted by key in std::vector, base of FlatMap and FlatSet.
+        Lookup is binary search over contiguous memory, insertion and erasure move elements after position.
+        Deserialization appends elements and sorts them only if they were not sorted already,
+        so data written from std::map/std::set(or flat containers) is loaded in O(n).
+    */
+    template<typename Value, typename Key, typename KeyOf, typename Compare>
+    class FlatSortedVector
+    {
+    public:
+        typedef Key key_type;
+        typedef Value value_type;
+        typedef Compare key_compare;
+        typedef size_t size_type;
+        typedef typename std::vector<Value>::iterator iterator;
+        typedef typename std::vector<Value>::const_iterator const_iterator;
+
+        FlatSortedVector() = default;
+        FlatSortedVector(std::initializer_list<Value> values)
+        {
+            for(auto& value : values) insert(value);
+        }
+
+        inline iterator begin() { return items.begin(); }
+        inline iterator end() { return items.end(); }
+        inline const_iterator begin() const { return items.begin(); }
+        inline const_iterator end() const { return items.end(); }
+        inline size_type size() const { return items.size(); }
+        inline bool empty() const { return items.empty(); }
+        inline void clear() { items.clear(); }
+        inline void reserve(size_type count) { items.reserve(count); }
+        inline size_type capacity() const { return items.capacity(); }
+
+        iterator lower_bound(const Key& key)
+        {
+            return std::lower_bound(items.begin(), items.end(), key, [this](const Value& v, const Key& k) { return comp(KeyOf{}(v), k); });
+        }
+
+        const_iterator lower_bound(const Key& key) const
+        {
+            return std::lower_bound(items.begin(), items.end(), key, [this](const Value& v, const Key& k) { return comp(KeyOf{}(v), k); });
+        }
+
+        iterator find(const Key& key)
+        {
+            iterator it = lower_bound(key);
+            return it != items.end() && !comp(key, KeyOf{}(*it)) ? it : items.end();
+        }
+
+        const_iterator find(const Key& key) const
+        {
+            const_iterator it = lower_bound(key);
+            return it != items.end() && !comp(key, KeyOf{}(*it)) ? it : items.end();
+        }
+
+        inline size_type count(const Key& key) const { return find(key) != items.end(); }
+
+        // the same as std::map::insert, existing element is not replaced
+        std::pair<iterator, bool> insert(Value value)
+        {
+            iterator it = lower_bound(KeyOf{}(value));
+            if(it != items.end() && !comp(KeyOf{}(value), KeyOf{}(*it))) return {it, false};
+            return {items.insert(it, std::move(value)), true};
+        }
+
+        size_type erase(const Key& key)
+        {
+            iterator it = find(key);
+            if(it == items.end()) return 0;
+            items.erase(it);
+            return 1;
+        }
+
+        inline iterator erase(const_iterator it) { return items.erase(it); }
+
+        bool operator==(const FlatSortedVector& other) const { return items == other.items; }
+        bool operator!=(const FlatSortedVector& other) const { return items != other.items; }
+
+    protected:
+        friend class ContainerSerializerHelper;
+
+        // restores order after elements were appended, the first of equal elements is kept
+        void sortAppended()
+        {
+            auto less = [this](const Value& a, const Value& b) { return comp(KeyOf{}(a), KeyOf{}(b)); };
+            auto equal = [this](const Value& a, const Value& b) { return !comp(KeyOf{}(a), KeyOf{}(b)) && !comp(KeyOf{}(b), KeyOf{}(a)); };
+            if(std::adjacent_find(items.begin(), items.end(), [&less](const Value& a, const Value& b) { return !less(a, b); }) == items.end()) return;
+            std::stable_sort(items.begin(), items.end(), less);
+            items.erase(std::unique(items.begin(), items.end(), equal), items.end());
+        }
+
+        std::vector<Value> items;
+        Compare comp;
+    };
+
+    template<typename Key, typename Value>
+    struct FlatMapKeyOf
+    {
+        inline const Key& operator()(const std::pair<Key, Value>& v) const { return v.first; }
+    };
+
+    template<typename Key>
+    struct FlatSetKeyOf
+    {
+        inline const Key& operator()(const Key& v) const { return v; }
+    };
+
+    /*
+        Sorted map on std::vector, written in the same format as std::map.
+        Elements are std::pair<Key, Value>, key must not be changed through iterator.
+    */
+    template<typename Key, typename Value, typename Compare = std::less<Key>>
+    class FlatMap : public FlatSortedVector<std::pair<Key, Value>, Key, FlatMapKeyOf<Key, Value>, Compare>
+    {
+        typedef FlatSortedVector<std::pair<Key, Value>, Key, FlatMapKeyOf<Key, Value>, Compare> Base;
+    public:
+        typedef Value mapped_type;
+        using Base::Base;
+
+        Value& operator[](const Key& key)
+        {
+            auto it = this->lower_bound(key);
+            if(it == this->end() || this->comp(key, it->first)) it = this->items.insert(it, std::pair<Key, Value>{key, Value{}});
+            return it->second;
+        }
+
+        Value& at(const Key& key)
+        {
+            auto it = this->find(key);
+            if(it == this->end()) throw std::out_of_range{"FlatMap::at() - no such key"};
+            return it->second;
+        }
+
+        const Value& at(const Key& key) const
+        {
+            auto it = this->find(key);
+            if(it == this->end()) throw std::out_of_range{"FlatMap::at() - no such key"};
+            return it->second;
+        }
+    };
+
+    // sorted set on std::vector, written in the same format as std::set
+    template<typename Key, typename Compare = std::less<Key>>
+    class FlatSet : public FlatSortedVector<Key, Key, FlatSetKeyOf<Key>, Compare>
+    {
+        typedef FlatSortedVector<Key, Key, FlatSetKeyOf<Key>, Compare> Base;
+    public:
+        using Base::Base;
+    };
+
+
+    /*
+        Hash map with open addressing and linear probing, written in the same format as std::unordered_map.
+        Elements are stored in one array of slots(with one byte of state for every slot), so there is no allocation per element.
+        Table size is power of two, hash is mixed with multiplication, so std::hash of integers(identity) is fine.
+        Erasure shifts following elements back instead of leaving tombstones.
+        Key and Value must be default constructible, key must not be changed through iterator.
+    */
+    template<typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+    class FlatHashMap
+    {
+    public:
+        typedef Key key_type;
+        typedef Value mapped_type;
+        typedef std::pair<Key, Value> value_type;
+        typedef size_t size_type;
+
+        template<typename Map, typename Ref>
+        class Iterator
+        {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef FlatHashMap::value_type value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef Ref& reference;
+            typedef Ref* pointer;
+
+            Iterator(Map* _map, size_t _slot)
+                : map{_map}, slot{_slot} { skipEmpty(); }
+
+            inline reference operator*() const { return map->slots[slot]; }
+            inline pointer operator->() const { return &map->slots[slot]; }
+            inline Iterator& operator++() { ++slot; skipEmpty(); return *this; }
+            inline Iterator operator++(int) { Iterator old = *this; ++*this; return old; }
+            inline bool operator==(const Iterator& other) const { return slot == other.slot; }
+            inline bool operator!=(const Iterator& other) const { return slot != other.slot; }
+
+        private:
+            friend class FlatHashMap;
+
+            inline void skipEmpty() { while(slot < map->used.size() && !map->used[slot]) ++slot; }
+
+            Map* map;
+            size_t slot;
+        };
+
+        typedef Iterator<FlatHashMap, value_type> iterator;
+        typedef Iterator<const FlatHashMap, const value_type> const_iterator;
+
+        FlatHashMap() = default;
+        FlatHashMap(std::initializer_list<value_type> values)
+        {
+            reserve(values.size());
+            for(auto& value : values) insert(value);
+        }
+
+        inline iterator begin() { return iterator(this, 0); }
+        inline iterator end() { return iterator(this, used.size()); }
+        inline const_iterator begin() const { return const_iterator(this, 0); }
+        inline const_iterator end() const { return const_iterator(this, used.size()); }
+        inline size_type size() const { return elements; }
+        inline bool empty() const { return elements == 0; }
+        inline size_type bucket_count() const { return used.size(); }
+
+        void clear()
+        {
+            std::fill(used.begin(), used.end(), 0);
+            for(auto& slot : slots) slot = value_type{};
+            elements = 0;
+        }
+
+        // makes room for 'n' elements without rehashing
+        void reserve(size_type n)
+        {
+            size_t wanted = MinSlots;
+            while(wanted - wanted / 4 < n) wanted *= 2;
+            if(wanted > used.size()) rehash(wanted);
+        }
+
+        iterator find(const Key& key)
+        {
+            if(used.empty()) return end();
+            size_t slot = findSlot(key);
+            return iterator(this, used[slot] ? slot : used.size());
+        }
+
+        const_iterator find(const Key& key) const
+        {
+            if(used.empty()) return end();
+            size_t slot = findSlot(key);
+            return const_iterator(this, used[slot] ? slot : used.size());
+        }
+
+        inline size_type count(const Key& key) const { return find(key) != end(); }
+
+        // the same as std::unordered_map::insert, existing element is not replaced
+        std::pair<iterator, bool> insert(value_type value)
+        {
+            reserve(elements + 1);
+            size_t slot = findSlot(value.first);
+            if(used[slot]) return {iterator(this, slot), false};
+            slots[slot] = std::move(value);
+            used[slot] = 1;
+            ++elements;
+            return {iterator(this, slot), true};
+        }
+
+        Value& operator[](const Key& key)
+        {
+            reserve(elements + 1);
+            size_t slot = findSlot(key);
+            if(!used[slot])
+            {
+                slots[slot] = value_type{key, Value{}};
+                used[slot] = 1;
+                ++elements;
+            }
+            return slots[slot].second;
+        }
+
+        Value& at(const Key& key)
+        {
+            auto it = find(key);
+            if(it == end()) throw std::out_of_range{"FlatHashMap::at() - no such key"};
+            return it->second;
+        }
+
+        const Value& at(const Key& key) const
+        {
+            auto it = find(key);
+            if(it == end()) throw std::out_of_range{"FlatHashMap::at() - no such key"};
+            return it->second;
+        }
+
+        size_type erase(const Key& key)
+        {
+            if(elements == 0) return 0;
+            size_t slot = findSlot(key);
+            if(!used[slot]) return 0;
+            // elements after erased one are moved back, if it is closer to their home slots
+            size_t mask = used.size() - 1;
+            size_t next = (slot + 1) & mask;
+            while(used[next])
+            {
+                size_t home = homeSlot(slots[next].first);
+                // 'next' can fill 'slot' if its home is not in (slot, next]
+                if(((next - home) & mask) >= ((next - slot) & mask))
+                {
+                    slots[slot] = std::move(slots[next]);
+                    slot = next;
+                }
+                next = (next + 1) & mask;
+            }
+            slots[slot] = value_type{};
+            used[slot] = 0;
+            --elements;
+            return 1;
+        }
+
+        // the same as std::unordered_map, order of elements doesn't matter
+        bool operator==(const FlatHashMap& other) const
+        {
+            if(elements != other.elements) return false;
+            for(auto& value : *this)
+            {
+                auto it = other.find(value.first);
+                if(it == other.end() || !(it->second == value.second)) return false;
+            }
+            return true;
+        }
+
+        bool operator!=(const FlatHashMap& other) const { return !(*this == other); }
+
+    private:
+        static constexpr size_t MinSlots = 16;
+
+        inline size_t homeSlot(const Key& key) const
+        {
+            // Fibonacci hashing, takes high bits of product
+            uint64_t h = static_cast<uint64_t>(hash(key)) * 0x9E3779B97F4A7C15ull;
+            return static_cast<size_t>(h >> (64 - bits));
+        }
+
+        // slot with 'key' or empty slot where it would be; table must not be empty
+        size_t findSlot(const Key& key) const
+        {
+            size_t mask = used.size() - 1;
+            size_t slot = homeSlot(key);
+            while(used[slot] && !equal(slots[slot].first, key)) slot = (slot + 1) & mask;
+            return slot;
+        }
+
+        void rehash(size_t newSize)
+        {
+            std::vector<value_type> oldSlots(newSize);
+            std::vector<uint8_t> oldUsed(newSize, 0);
+            oldSlots.swap(slots);
+            oldUsed.swap(used);
+            bits = 0;
+            while((size_t(1) << bits) < newSize) ++bits;
+            for(size_t i = 0; i < oldUsed.size(); ++i)
+            {
+                if(!oldUsed[i]) continue;
+                size_t slot = findSlot(oldSlots[i].first);
+                slots[slot] = std::move(oldSlots[i]);
+                used[slot] = 1;
+            }
+        }
+
+        std::vector<value_type> slots;
+        std::vector<uint8_t> used;
+        size_t elements = 0;
+        unsigned bits = 0;
+        Hash hash;
+        KeyEqual equal;
+    };
+
+
+    // flat containers are filled by appending, order is restored once at the end
+    template<typename Key, typename Value, typename Compare>
+    struct ContainerSerializerHelper::ContainerAdder<FlatMap<Key, Value, Compare>>
+    {
+        typedef FlatMap<Key, Value, Compare> T;
+
+        template<typename Val>
+        static void addTo(T* cont, Val* val)
+        {
+            cont->items.push_back(std::move(*val));
+        }
+
+        static void prepare(T* cont, ElementsCount count) { cont->reserve(count); }
+        static void finish(T* cont) { cont->sortAppended(); }
+    };
+
+    template<typename Key, typename Compare>
+    struct ContainerSerializerHelper::ContainerAdder<FlatSet<Key, Compare>>
+    {
+        typedef FlatSet<Key, Compare> T;
+
+        template<typename Val>
+        static void addTo(T* cont, Val* val)
+        {
+            cont->items.push_back(std::move(*val));
+        }
+
+        static void prepare(T* cont, ElementsCount count) { cont->reserve(count); }
+        static void finish(T* cont) { cont->sortAppended(); }
+    };
+
+    template<typename Key, typename Value, typename Hash, typename KeyEqual>
+    struct ContainerSerializerHelper::ContainerAdder<FlatHashMap<Key, Value, Hash, KeyEqual>>
+    {
+        typedef FlatHashMap<Key, Value, Hash, KeyEqual> T;
+
+        template<typename Val>
+        static void addTo(T* cont, Val* val)
+        {
+            cont->insert(std::move(*val));
+        }
+
+        static void prepare(T* cont, ElementsCount count) { cont->reserve(count); }
+        static void finish(T*) {}
+    };
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include "../serializer.hpp"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+/*
+    Common part of libFuzzer targets.
+    Every target uses first input byte to select type inside its family and feeds the rest raw fuzzer input to one deserializer and, if it was decoded successfully, checks that:
+        - returned BytesCount is not bigger than input;
+        - encoding of decoded value returns the same BytesCount as its size in buffer;
+        - decoding of this encoding consumes exactly the same bytes and gives the same value back.
+    Build with clang:
+        clang++ -std=c++17 -g -O1 -fsanitize=fuzzer,address,undefined -I. fuzz/fuzz_strings.cpp serializer.cpp -o fuzz_strings
+    Without libFuzzer(g++) targets can be built with -DSERIALIZER_FUZZ_STANDALONE, then they run over files passed in command line.
+*/
+namespace SerializationFuzz
+{
+    namespace S = Serialization;
+
+    inline void fuzzAssert(bool cond, const char* what)
+    {
+        if(!cond)
+        {
+            fprintf(stderr, "fuzz check failed: %s\n", what);
+            abort();
+        }
+    }
+
+    /*
+        'ByteExact' should be false for types, whose encoding order depends on insertion order(unordered containers).
+        For them decoded values are compared with operator==.
+    */
+    template<typename T, bool ByteExact = true>
+    void checkRoundTrip(const uint8_t* data, size_t size)
+    {
+        std::string input(reinterpret_cast<const char*>(data), size);
+        T value;
+        S::BytesCount consumed;
+        try
+        {
+            consumed = S::Deserializer::deserializeAll(input, 0, &value);
+        }
+        catch(const S::SerializerExceptions::OutOfBounds&)
+        {
+            // malformed input must be rejected, not crash
+            return;
+        }
+        catch(const S::SerializerExceptions::InvalidType&)
+        {
+            // unknown polymorphic type id
+            return;
+        }
+        fuzzAssert(consumed <= size, "consumed more bytes than buffer has");
+
+        std::string encoded;
+        S::BytesCount written = S::Serializer::serializeAll(encoded, &value);
+        fuzzAssert(written == encoded.size(), "serializer returned wrong BytesCount");
+
+        T decoded;
+        S::BytesCount read = S::Deserializer::deserializeAll(encoded, 0, &decoded);
+        fuzzAssert(read == written, "deserializer consumed not the same bytes that serializer wrote");
+
+        std::string reencoded;
+        S::Serializer::serializeAll(reencoded, &decoded);
+        if constexpr(ByteExact)
+        {
+            fuzzAssert(encoded == reencoded, "encoding is not stable");
+        }
+        else
+        {
+            fuzzAssert(value == decoded, "decoded value differs");
+        }
+    }
+}
+
+#ifdef SERIALIZER_FUZZ_STANDALONE
+// replays inputs from files(corpus or crash reproducers) when libFuzzer is not available
+int main(int argc, char** argv)
+{
+    for(int i = 1; i < argc; ++i)
+    {
+        std::ifstream in(argv[i], std::ios::binary);
+        std::string input{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+    }
+    return 0;
+}
+#endif
@@ -0,0 +1,18 @@
+#include "fuzz.hpp"
+
+using namespace SerializationFuzz;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if(size == 0) return 0;
+    switch(data[0] % 6)
+    {
+    case 0: checkRoundTrip<char>(data + 1, size - 1); break;
+    case 1: checkRoundTrip<short>(data + 1, size - 1); break;
+    case 2: checkRoundTrip<int>(data + 1, size - 1); break;
+    case 3: checkRoundTrip<uint64_t>(data + 1, size - 1); break;
+    case 4: checkRoundTrip<float>(data + 1, size - 1); break;
+    case 5: checkRoundTrip<double>(data + 1, size - 1); break;
+    }
+    return 0;
+}
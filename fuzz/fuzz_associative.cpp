@@ -0,0 +1,48 @@
+#include "fuzz.hpp"
+#include "../flatcontainers.hpp"
+
+using namespace SerializationFuzz;
+
+namespace
+{
+    struct LookupTable : public S::Serializable, public S::Deserializable
+    {
+        S::PrecomputedHashMap<std::string, int> table;
+
+        S::BytesCount serialize(std::string& buf)
+        {
+            S::HashTableWrapper<S::PrecomputedHashMap<std::string, int>> w{&table};
+            return S::Serializer::serializeAll(buf, &w);
+        }
+
+        S::BytesCount deserialize(const std::string& buf, S::BytesCount offset)
+        {
+            S::HashTableWrapper<S::PrecomputedHashMap<std::string, int>> w{&table};
+            return S::Deserializer::deserializeAll(buf, offset, &w);
+        }
+
+        bool operator==(const LookupTable& other) const { return table == other.table; }
+    };
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if(size == 0) return 0;
+    switch(data[0] % 13)
+    {
+    case 0: checkRoundTrip<std::map<int, std::string>>(data + 1, size - 1); break;
+    case 1: checkRoundTrip<std::multimap<std::string, std::vector<int>>>(data + 1, size - 1); break;
+    case 2: checkRoundTrip<std::set<std::string>>(data + 1, size - 1); break;
+    case 3: checkRoundTrip<std::multiset<std::vector<char>>>(data + 1, size - 1); break;
+    case 4: checkRoundTrip<std::unordered_map<int, std::string>, false>(data + 1, size - 1); break;
+    case 5: checkRoundTrip<std::unordered_multimap<std::string, int>, false>(data + 1, size - 1); break;
+    case 6: checkRoundTrip<std::unordered_set<std::string>, false>(data + 1, size - 1); break;
+    case 7: checkRoundTrip<std::unordered_multiset<int>, false>(data + 1, size - 1); break;
+    case 8: checkRoundTrip<LookupTable, false>(data + 1, size - 1); break;
+    case 9: checkRoundTrip<S::FlatMap<int, std::string>>(data + 1, size - 1); break;
+    case 10: checkRoundTrip<S::FlatHashMap<std::string, int>, false>(data + 1, size - 1); break;
+    case 11: checkRoundTrip<S::FlatSet<std::string>>(data + 1, size - 1); break;
+    case 12: checkRoundTrip<S::FlatHashMap<int, int>, false>(data + 1, size - 1); break;
+    }
+    return 0;
+}
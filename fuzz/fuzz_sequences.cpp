@@ -0,0 +1,65 @@
+#include "fuzz.hpp"
+
+using namespace SerializationFuzz;
+
+namespace
+{
+    template<typename T>
+    struct Varints : public S::Serializable, public S::Deserializable
+    {
+        std::vector<T> values;
+
+        S::BytesCount serialize(std::string& buf)
+        {
+            S::VarintWrapper<T> w{&values};
+            return S::Serializer::serializeAll(buf, &w);
+        }
+
+        S::BytesCount deserialize(const std::string& buf, S::BytesCount offset)
+        {
+            S::VarintWrapper<T> w{&values};
+            return S::Deserializer::deserializeAll(buf, offset, &w);
+        }
+    };
+
+    template<typename T>
+    struct FloatSeries : public S::Serializable, public S::Deserializable
+    {
+        std::vector<T> values;
+
+        S::BytesCount serialize(std::string& buf)
+        {
+            S::FloatSeriesWrapper w{&values};
+            return S::Serializer::serializeAll(buf, &w);
+        }
+
+        S::BytesCount deserialize(const std::string& buf, S::BytesCount offset)
+        {
+            S::FloatSeriesWrapper w{&values};
+            return S::Deserializer::deserializeAll(buf, offset, &w);
+        }
+    };
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if(size == 0) return 0;
+    switch(data[0] % 14)
+    {
+    case 0: checkRoundTrip<std::vector<int>>(data + 1, size - 1); break;
+    case 1: checkRoundTrip<std::vector<double>>(data + 1, size - 1); break;
+    case 2: checkRoundTrip<std::list<char>>(data + 1, size - 1); break;
+    case 3: checkRoundTrip<std::deque<std::string>>(data + 1, size - 1); break;
+    case 4: checkRoundTrip<std::vector<std::vector<std::string>>>(data + 1, size - 1); break;
+    case 5: checkRoundTrip<std::vector<std::pair<short, std::list<int>>>>(data + 1, size - 1); break;
+    case 6: checkRoundTrip<S::OwningArrayWrapper<int>>(data + 1, size - 1); break;
+    case 7: checkRoundTrip<S::OwningArrayWrapper<std::string>>(data + 1, size - 1); break;
+    case 8: checkRoundTrip<std::vector<bool>>(data + 1, size - 1); break;
+    case 9: checkRoundTrip<Varints<int16_t>>(data + 1, size - 1); break;
+    case 10: checkRoundTrip<Varints<uint32_t>>(data + 1, size - 1); break;
+    case 11: checkRoundTrip<Varints<int64_t>>(data + 1, size - 1); break;
+    case 12: checkRoundTrip<FloatSeries<float>>(data + 1, size - 1); break;
+    case 13: checkRoundTrip<FloatSeries<double>>(data + 1, size - 1); break;
+    }
+    return 0;
+}
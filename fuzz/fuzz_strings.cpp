@@ -0,0 +1,17 @@
+#include "fuzz.hpp"
+
+using namespace SerializationFuzz;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if(size == 0) return 0;
+    switch(data[0] % 5)
+    {
+    case 0: checkRoundTrip<std::string>(data + 1, size - 1); break;
+    case 1: checkRoundTrip<std::pair<std::string, std::string>>(data + 1, size - 1); break;
+    case 2: checkRoundTrip<std::pair<int, std::string>>(data + 1, size - 1); break;
+    case 3: checkRoundTrip<std::vector<std::string_view>>(data + 1, size - 1); break;
+    case 4: checkRoundTrip<std::map<std::string_view, std::string_view>>(data + 1, size - 1); break;
+    }
+    return 0;
+}
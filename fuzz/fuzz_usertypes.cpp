@@ -0,0 +1,73 @@
+#include "fuzz.hpp"
+
+using namespace SerializationFuzz;
+
+namespace
+{
+    struct Record : public S::Serializable, public S::Deserializable
+    {
+        std::string name;
+        int age = 0;
+        std::vector<std::string> tags;
+        std::map<short, double> scores;
+
+        S::BytesCount serialize(std::string& buf)
+        {
+            return S::Serializer::serializeAll(buf, &name, &age, &tags, &scores);
+        }
+
+        S::BytesCount deserialize(const std::string& buf, S::BytesCount offset)
+        {
+            return S::Deserializer::deserializeAll(buf, offset, &name, &age, &tags, &scores);
+        }
+    };
+
+    struct MultiRecord : public S::MultipleSerializable, public S::MultipleDeserializable
+    {
+        MultiRecord()
+        {
+            registerSerializer(S::SerializerId(0), [this](std::string& buf) { return S::Serializer::serializeAll(buf, &id, &payload); } );
+            registerDeserializer(S::SerializerId(0), [this](const std::string& buf, S::BytesCount offset) { return S::Deserializer::deserializeAll(buf, offset, &id, &payload); } );
+            setSerializerId(0);
+            setDeserializerId(0);
+        }
+        uint32_t id = 0;
+        std::list<std::string> payload;
+    };
+
+    struct Shape : public S::PolymorphicSerializable
+    {
+        int32_t color = 0;
+    };
+
+    struct Circle : public S::RegisteredType<Circle, Shape, 1>
+    {
+        double radius = 0;
+
+        S::BytesCount serialize(std::string& buf) { return S::Serializer::serializeAll(buf, &color, &radius); }
+        S::BytesCount deserialize(const std::string& buf, S::BytesCount offset) { return S::Deserializer::deserializeAll(buf, offset, &color, &radius); }
+    };
+
+    struct Polygon : public S::RegisteredType<Polygon, Shape, 2>
+    {
+        std::vector<std::pair<float, float>> points;
+
+        S::BytesCount serialize(std::string& buf) { return S::Serializer::serializeAll(buf, &color, &points); }
+        S::BytesCount deserialize(const std::string& buf, S::BytesCount offset) { return S::Deserializer::deserializeAll(buf, offset, &color, &points); }
+    };
+
+    const bool shapesRegistered = S::TypeRegistry<Shape>::registerTypes<Circle, Polygon>();
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    if(size == 0) return 0;
+    switch(data[0] % 4)
+    {
+    case 0: checkRoundTrip<Record>(data + 1, size - 1); break;
+    case 1: checkRoundTrip<std::vector<Record>>(data + 1, size - 1); break;
+    case 2: checkRoundTrip<MultiRecord>(data + 1, size - 1); break;
+    case 3: checkRoundTrip<std::vector<std::unique_ptr<Shape>>>(data + 1, size - 1); break;
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "mappedfile.hpp"
+#include <cstdio>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define SERIALIZER_HAS_MMAP
+#endif
+
+Serialization::MappedFile::MappedFile(const std::string& path)
+    : begin{nullptr}, length{0}
+{
+#ifdef SERIALIZER_HAS_MMAP
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) throw SerializerExceptions::InvalidArgs{"MappedFile() - can't open " + path};
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+    {
+        close(fd);
+        throw SerializerExceptions::InvalidArgs{"MappedFile() - can't get size of " + path};
+    }
+    length = static_cast<size_t>(st.st_size);
+    // empty file can't be mapped, it is just empty view
+    if(length > 0)
+    {
+        void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(p == MAP_FAILED)
+        {
+            close(fd);
+            throw SerializerExceptions::InvalidArgs{"MappedFile() - can't map " + path};
+        }
+        begin = static_cast<const char*>(p);
+    }
+    // mapping stays valid after descriptor is closed
+    close(fd);
+#else
+    FILE* file = fopen(path.c_str(), "rb");
+    if(!file) throw SerializerExceptions::InvalidArgs{"MappedFile() - can't open " + path};
+    fseek(file, 0, SEEK_END);
+    long end = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    length = end > 0 ? static_cast<size_t>(end) : 0;
+    storage.reset(new char[length > 0 ? length : 1]);
+    if(fread(storage.get(), 1, length, file) != length)
+    {
+        fclose(file);
+        throw SerializerExceptions::InvalidArgs{"MappedFile() - can't read " + path};
+    }
+    fclose(file);
+    begin = storage.get();
+#endif
+}
+
+Serialization::MappedFile::~MappedFile()
+{
+    release();
+}
+
+Serialization::MappedFile::MappedFile(MappedFile&& other) noexcept
+    : begin{other.begin}, length{other.length}, storage{std::move(other.storage)}
+{
+    other.begin = nullptr;
+    other.length = 0;
+}
+
+Serialization::MappedFile& Serialization::MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if(this != &other)
+    {
+        release();
+        begin = other.begin;
+        length = other.length;
+        storage = std::move(other.storage);
+        other.begin = nullptr;
+        other.length = 0;
+    }
+    return *this;
+}
+
+void Serialization::MappedFile::release()
+{
+#ifdef SERIALIZER_HAS_MMAP
+    if(begin != nullptr) munmap(const_cast<char*>(begin), length);
+#endif
+    begin = nullptr;
+    length = 0;
+    storage.reset();
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <memory>
+#include "serializer.hpp"
+
+namespace Serialization
+{
+    /*
+        Read-only view of whole file in memory.
+        On POSIX systems file is mmapped(pages are loaded on first access, nothing is copied), elsewhere it is read into memory.
+        Data is aligned at least to 16 bytes, so arrays written with AlignedWrapper can be viewed in place(Deserializer::viewAligned).
+    */
+    class MappedFile
+    {
+    public:
+        // throws InvalidArgs if file can't be opened or mapped
+        explicit MappedFile(const std::string& path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+
+        inline const char* data() const { return begin; }
+        inline size_t size() const { return length; }
+
+    private:
+        void release();
+
+        const char* begin;
+        size_t length;
+        // used if file can't be mmapped on this system
+        std::unique_ptr<char[]> storage;
+    };
+}
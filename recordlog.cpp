@@ -0,0 +1,193 @@
+#include "recordlog.hpp"
+#include <random>
+
+Serialization::RecordLogWriter::RecordLogWriter(const std::string& path, size_t _recordsPerBlock)
+    : file{fopen(path.c_str(), "wb")}, recordsPerBlock{std::max<size_t>(_recordsPerBlock, 1)}, records{0}, offset{0}
+{
+    if(!file) throw SerializerExceptions::InvalidArgs{"RecordLogWriter() - can't open " + path};
+    std::random_device random;
+    for(size_t i = 0; i < RecordLog::SyncSize; i += sizeof(unsigned))
+    {
+        unsigned r = random();
+        memcpy(sync + i, &r, std::min(sizeof(r), RecordLog::SyncSize - i));
+    }
+    uint64_t perBlock = recordsPerBlock;
+    writeBytes(RecordLog::HeaderMagic, sizeof(RecordLog::HeaderMagic));
+    writeBytes(sync, sizeof(sync));
+    writeBytes(&perBlock, sizeof(perBlock));
+}
+
+Serialization::RecordLogWriter::~RecordLogWriter()
+{
+    // destructor can't throw, log without footer is still readable
+    try
+    {
+        close();
+    }
+    catch(const SerializerExceptions::InvalidArgs&)
+    {
+    }
+}
+
+size_t Serialization::RecordLogWriter::appendRecord(const char* data, size_t size)
+{
+    if(!file) throw SerializerExceptions::InvalidArgs{"RecordLogWriter::appendRecord() - log is closed"};
+    if(records % recordsPerBlock == 0)
+    {
+        uint64_t first = records;
+        blockOffsets.push_back(offset);
+        writeBytes(sync, sizeof(sync));
+        writeBytes(&first, sizeof(first));
+    }
+    uint64_t recordSize = size;
+    writeBytes(&recordSize, sizeof(recordSize));
+    writeBytes(data, size);
+    return records++;
+}
+
+void Serialization::RecordLogWriter::flush()
+{
+    if(file && fflush(file) != 0) throw SerializerExceptions::InvalidArgs{"RecordLogWriter::flush() - write failed"};
+}
+
+void Serialization::RecordLogWriter::close()
+{
+    if(!file) return;
+    uint64_t blocks = blockOffsets.size();
+    uint64_t count = records;
+    try
+    {
+        writeBytes(blockOffsets.data(), blockOffsets.size() * sizeof(uint64_t));
+        writeBytes(&blocks, sizeof(blocks));
+        writeBytes(&count, sizeof(count));
+        writeBytes(RecordLog::FooterMagic, sizeof(RecordLog::FooterMagic));
+    }
+    catch(const SerializerExceptions::InvalidArgs&)
+    {
+        fclose(file);
+        file = nullptr;
+        throw;
+    }
+    // the end of footer is usually still in stdio buffer and is written by fclose
+    bool closed = fclose(file) == 0;
+    file = nullptr;
+    if(!closed) throw SerializerExceptions::InvalidArgs{"RecordLogWriter::close() - write failed"};
+}
+
+void Serialization::RecordLogWriter::writeBytes(const void* data, size_t size)
+{
+    if(size > 0 && fwrite(data, 1, size, file) != size) throw SerializerExceptions::InvalidArgs{"RecordLogWriter - write failed"};
+    offset += size;
+}
+
+
+Serialization::RecordLogReader::RecordLogReader(const std::string& path)
+    : file{path}, sync{nullptr}, recordsPerBlock{0}, records{0}, dataEnd{0}
+{
+    if(file.size() < RecordLog::HeaderSize || memcmp(file.data(), RecordLog::HeaderMagic, sizeof(RecordLog::HeaderMagic)) != 0)
+    {
+        throw SerializerExceptions::InvalidArgs{"RecordLogReader() - " + path + " is not a record log"};
+    }
+    sync = file.data() + sizeof(RecordLog::HeaderMagic);
+    memcpy(&recordsPerBlock, sync + RecordLog::SyncSize, sizeof(recordsPerBlock));
+    if(recordsPerBlock == 0) throw SerializerExceptions::InvalidArgs{"RecordLogReader() - " + path + " is not a record log"};
+    loadIndex();
+}
+
+std::string& Serialization::RecordLogReader::recordBuffer()
+{
+    thread_local std::string buffer;
+    return buffer;
+}
+
+void Serialization::RecordLogReader::loadIndex()
+{
+    const size_t trailerSize = 2 * sizeof(uint64_t) + sizeof(RecordLog::FooterMagic);
+    size_t size = file.size();
+    if(size >= RecordLog::HeaderSize + trailerSize &&
+       memcmp(file.data() + size - sizeof(RecordLog::FooterMagic), RecordLog::FooterMagic, sizeof(RecordLog::FooterMagic)) == 0)
+    {
+        uint64_t blocks;
+        memcpy(&blocks, file.data() + size - trailerSize, sizeof(blocks));
+        memcpy(&records, file.data() + size - trailerSize + sizeof(blocks), sizeof(records));
+        uint64_t available = (size - RecordLog::HeaderSize - trailerSize) / sizeof(uint64_t);
+        if(blocks <= available && blocks == (records + recordsPerBlock - 1) / recordsPerBlock)
+        {
+            dataEnd = size - trailerSize - blocks * sizeof(uint64_t);
+            blockOffsets.resize(blocks);
+            if(blocks > 0) memcpy(blockOffsets.data(), file.data() + dataEnd, blocks * sizeof(uint64_t));
+            // offsets must grow, parallelScan splits them by binary search
+            bool valid = true;
+            uint64_t previous = 0;
+            for(uint64_t offset : blockOffsets)
+            {
+                valid = valid && offset >= RecordLog::HeaderSize && offset <= dataEnd - RecordLog::BlockHeaderSize && offset >= previous &&
+                        memcmp(file.data() + offset, sync, RecordLog::SyncSize) == 0;
+                previous = offset + RecordLog::BlockHeaderSize;
+            }
+            if(valid) return;
+        }
+    }
+    rebuildIndex();
+}
+
+// log that was not closed: blocks are read one by one, until the last complete record
+void Serialization::RecordLogReader::rebuildIndex()
+{
+    blockOffsets.clear();
+    records = 0;
+    uint64_t pos = RecordLog::HeaderSize;
+    size_t size = file.size();
+    dataEnd = size;
+    uint64_t first;
+    while(readBlockHeader(pos, &first) && first == records)
+    {
+        uint64_t blockStart = pos;
+        pos += RecordLog::BlockHeaderSize;
+        uint64_t inBlock = 0;
+        while(inBlock < recordsPerBlock && size - pos >= RecordLog::RecordHeaderSize)
+        {
+            uint64_t recordSize;
+            memcpy(&recordSize, file.data() + pos, sizeof(recordSize));
+            if(recordSize > size - pos - RecordLog::RecordHeaderSize) break;
+            pos += RecordLog::RecordHeaderSize + recordSize;
+            ++inBlock;
+        }
+        if(inBlock == 0) break;
+        blockOffsets.push_back(blockStart);
+        records += inBlock;
+        if(inBlock < recordsPerBlock) break;
+    }
+    dataEnd = pos;
+}
+
+bool Serialization::RecordLogReader::readBlockHeader(uint64_t pos, uint64_t* firstRecord) const
+{
+    if(pos > dataEnd || dataEnd - pos < RecordLog::BlockHeaderSize || memcmp(file.data() + pos, sync, RecordLog::SyncSize) != 0) return false;
+    memcpy(firstRecord, file.data() + pos + RecordLog::SyncSize, sizeof(*firstRecord));
+    return true;
+}
+
+uint64_t Serialization::RecordLogReader::readRecord(uint64_t pos, std::string_view* record) const
+{
+    uint64_t recordSize;
+    Deserializer::checkBounds(dataEnd, pos, RecordLog::RecordHeaderSize);
+    memcpy(&recordSize, file.data() + pos, sizeof(recordSize));
+    pos += RecordLog::RecordHeaderSize;
+    Deserializer::checkBounds(dataEnd, pos, recordSize);
+    *record = std::string_view(file.data() + pos, recordSize);
+    return pos + recordSize;
+}
+
+std::string_view Serialization::RecordLogReader::record(size_t index) const
+{
+    if(index >= records) throw SerializerExceptions::OutOfBounds{"RecordLogReader::record() - no such record"};
+    uint64_t pos = blockOffsets[index / recordsPerBlock] + RecordLog::BlockHeaderSize;
+    std::string_view r;
+    for(uint64_t skip = index % recordsPerBlock; skip > 0; --skip)
+    {
+        pos = readRecord(pos, &r);
+    }
+    readRecord(pos, &r);
+    return r;
+}
@@ -0,0 +1,183 @@
+#pragma once
+#include <cstdio>
+#include <algorithm>
+#include <thread>
+#include <exception>
+#include "serializer.hpp"
+#include "mappedfile.hpp"
+
+namespace Serialization
+{
+    /*
+        Append-only log of serialized records.
+        File format:
+            - header: magic(8 bytes), sync marker(16 random bytes), records per block;
+            - blocks: sync marker, number of first record in block, then up to 'recordsPerBlock' records(size as 8 bytes, then data);
+            - footer(written by close()): offsets of all blocks, blocks count, records count, magic(8 bytes).
+        Footer is sparse index: record k is found by offset of block k / recordsPerBlock, then skipping at most recordsPerBlock - 1 records.
+        If log was not closed(no footer), reader rebuilds index by scanning blocks.
+    */
+    class RecordLog
+    {
+    public:
+        static constexpr size_t SyncSize = 16;
+        static constexpr char HeaderMagic[8] = {'S', 'E', 'R', 'L', 'O', 'G', '0', '1'};
+        static constexpr char FooterMagic[8] = {'S', 'E', 'R', 'L', 'O', 'G', 'I', 'X'};
+        static constexpr size_t HeaderSize = sizeof(HeaderMagic) + SyncSize + sizeof(uint64_t);
+        static constexpr size_t BlockHeaderSize = SyncSize + sizeof(uint64_t);
+        static constexpr size_t RecordHeaderSize = sizeof(uint64_t);
+    };
+
+    /*
+        Writes log file, existing file is overwritten.
+    */
+    class RecordLogWriter
+    {
+    public:
+        // throws InvalidArgs if file can't be opened
+        explicit RecordLogWriter(const std::string& path, size_t recordsPerBlock = 1024);
+        // closes log if it was not closed
+        ~RecordLogWriter();
+
+        RecordLogWriter(const RecordLogWriter&) = delete;
+        RecordLogWriter& operator=(const RecordLogWriter&) = delete;
+
+        // serializes arguments as one record, returns its number
+        template<typename... Args>
+        size_t append(Args... args)
+        {
+            buffer.clear();
+            Serializer::serializeAll(buffer, args...);
+            return appendRecord(buffer.data(), buffer.size());
+        }
+
+        size_t appendRecord(const char* data, size_t size);
+        // passes written records to OS, throws InvalidArgs if writing failed
+        void flush();
+        // writes index and closes file, nothing can be appended after it; throws InvalidArgs if writing failed(file is closed anyway)
+        void close();
+
+        inline size_t size() const { return records; }
+
+    private:
+        void writeBytes(const void* data, size_t size);
+
+        FILE* file;
+        size_t recordsPerBlock;
+        size_t records;
+        uint64_t offset;
+        char sync[RecordLog::SyncSize];
+        std::vector<uint64_t> blockOffsets;
+        std::string buffer;
+    };
+
+    /*
+        Reads log file mapped in memory. Records are returned as views into mapped file.
+        Reader is immutable after construction, so it can be used from many threads.
+    */
+    class RecordLogReader
+    {
+    public:
+        // throws InvalidArgs if file can't be opened or is not a record log
+        explicit RecordLogReader(const std::string& path);
+
+        inline size_t size() const { return records; }
+        inline size_t getRecordsPerBlock() const { return recordsPerBlock; }
+
+        // throws OutOfBounds if there is no such record
+        std::string_view record(size_t index) const;
+
+        // deserializes record 'index' into arguments, returns bytes read
+        template<typename... Args>
+        BytesCount read(size_t index, Args... args) const
+        {
+            std::string_view r = record(index);
+            // deserializer reads std::string, record is copied to buffer that is reused by this thread
+            std::string& buf = recordBuffer();
+            buf.assign(r.data(), r.size());
+            return Deserializer::deserializeAll(buf, 0, args...);
+        }
+
+        // calls callback(size_t index, std::string_view record) for every record in order
+        template<typename F>
+        void scan(F callback) const
+        {
+            for(uint64_t block = 0; block < blockOffsets.size(); ++block)
+            {
+                scanBlock(block, callback);
+            }
+        }
+
+        /*
+            Splits blocks of index into 'threads' parts of about the same number of bytes and scans them in parallel.
+            Index always exists: it is read from footer or rebuilt on opening, so blocks are not searched by sync markers.
+            Callback is called concurrently from different threads; records of one block are passed in order.
+            Exception thrown by callback is rethrown after all threads are finished.
+        */
+        template<typename F>
+        void parallelScan(F callback, size_t threads = std::thread::hardware_concurrency()) const
+        {
+            if(threads == 0) threads = 1;
+            uint64_t begin = RecordLog::HeaderSize;
+            uint64_t part = (dataEnd - begin + threads - 1) / threads;
+            std::vector<std::thread> workers;
+            std::vector<std::exception_ptr> errors(threads);
+            for(size_t i = 0; i < threads; ++i)
+            {
+                uint64_t from = std::min(begin + i * part, dataEnd);
+                uint64_t to = std::min(from + part, dataEnd);
+                // blocks that start in [from, to) belong to this part
+                size_t first = std::lower_bound(blockOffsets.begin(), blockOffsets.end(), from) - blockOffsets.begin();
+                size_t last = std::lower_bound(blockOffsets.begin(), blockOffsets.end(), to) - blockOffsets.begin();
+                workers.emplace_back([this, first, last, &callback, &errors, i]()
+                {
+                    try
+                    {
+                        for(size_t block = first; block < last; ++block) scanBlock(block, callback);
+                    }
+                    catch(...)
+                    {
+                        errors[i] = std::current_exception();
+                    }
+                });
+            }
+            for(std::thread& worker : workers) worker.join();
+            for(std::exception_ptr& error : errors)
+            {
+                if(error) std::rethrow_exception(error);
+            }
+        }
+
+    private:
+        static std::string& recordBuffer();
+
+        // reads record at 'pos', returns offset of the next one
+        uint64_t readRecord(uint64_t pos, std::string_view* record) const;
+        // returns false if there is no block header at 'pos'
+        bool readBlockHeader(uint64_t pos, uint64_t* firstRecord) const;
+        void loadIndex();
+        void rebuildIndex();
+
+        template<typename F>
+        void scanBlock(uint64_t block, F& callback) const
+        {
+            uint64_t first = block * recordsPerBlock;
+            uint64_t last = std::min<uint64_t>(first + recordsPerBlock, records);
+            uint64_t pos = blockOffsets[block] + RecordLog::BlockHeaderSize;
+            std::string_view r;
+            for(uint64_t index = first; index < last; ++index)
+            {
+                pos = readRecord(pos, &r);
+                callback(static_cast<size_t>(index), r);
+            }
+        }
+
+        MappedFile file;
+        const char* sync;
+        uint64_t recordsPerBlock;
+        uint64_t records;
+        // end of blocks(beginning of footer)
+        uint64_t dataEnd;
+        std::vector<uint64_t> blockOffsets;
+    };
+}
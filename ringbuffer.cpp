@@ -0,0 +1,122 @@
+#include "ringbuffer.hpp"
+#include <chrono>
+
+Serialization::RingBuffer::RingBuffer(size_t _capacity)
+    : capacity{64}, head{0}, tail{0}
+{
+    while(capacity < _capacity) capacity <<= 1;
+    mask = capacity - 1;
+    words.reset(new uint64_t[capacity / sizeof(uint64_t)]());
+}
+
+// headers are accessed atomically, record data is copied with memcpy and ordered by them
+uint64_t Serialization::RingBuffer::loadHeader(uint64_t position) const
+{
+    return __atomic_load_n(&words[(position & mask) / sizeof(uint64_t)], __ATOMIC_ACQUIRE);
+}
+
+void Serialization::RingBuffer::storeHeader(uint64_t position, uint64_t header)
+{
+    __atomic_store_n(&words[(position & mask) / sizeof(uint64_t)], header, __ATOMIC_RELEASE);
+}
+
+bool Serialization::RingBuffer::tryReserve(size_t size, uint64_t* position)
+{
+    if(size > maxRecordSize()) throw SerializerExceptions::InvalidArgs{"RingBuffer::tryPush() - record is too big"};
+    uint64_t total = HeaderSize + alignedSize(size);
+    uint64_t h = head.load(std::memory_order_relaxed);
+    uint64_t padding;
+    while(true)
+    {
+        uint64_t offset = h & mask;
+        // record is never split by the end of buffer
+        padding = offset + total > capacity ? capacity - offset : 0;
+        if(h + padding + total - tail.load(std::memory_order_acquire) > capacity) return false;
+        if(head.compare_exchange_weak(h, h + padding + total, std::memory_order_acq_rel, std::memory_order_relaxed)) break;
+    }
+    if(padding)
+    {
+        storeHeader(h, padding << FlagBits | Padding | Published);
+        h += padding;
+    }
+    *position = h;
+    return true;
+}
+
+bool Serialization::RingBuffer::tryPush(const char* data, size_t size)
+{
+    uint64_t position;
+    if(!tryReserve(size, &position)) return false;
+    if(size > 0) memcpy(recordData(position), data, size);
+    publish(position, size);
+    return true;
+}
+
+std::string& Serialization::RingBuffer::scratchBuffer()
+{
+    thread_local std::string buf;
+    return buf;
+}
+
+void Serialization::RingBuffer::release(uint64_t from, uint64_t to)
+{
+    if(from == to) return;
+    uint64_t begin = from & mask;
+    uint64_t length = to - from;
+    uint64_t first = std::min<uint64_t>(length, capacity - begin);
+    memset(bytes() + begin, 0, first);
+    if(length > first) memset(bytes(), 0, length - first);
+    tail.store(to, std::memory_order_release);
+}
+
+
+Serialization::RingBufferFileSink::RingBufferFileSink(const std::string& path, size_t capacity)
+    : ring{capacity}, file{fopen(path.c_str(), "wb")}, stopping{false}, failed{false}, flushed{0}
+{
+    if(!file) throw SerializerExceptions::InvalidArgs{"RingBufferFileSink() - can't open " + path};
+    consumer = std::thread(&RingBufferFileSink::run, this);
+}
+
+Serialization::RingBufferFileSink::~RingBufferFileSink()
+{
+    stopping.store(true, std::memory_order_release);
+    consumer.join();
+    fclose(file);
+}
+
+size_t Serialization::RingBufferFileSink::drain()
+{
+    bool ok = true;
+    size_t written = ring.consume([this, &ok](const char* data, size_t size) { ok = ok && fwrite(data, 1, size, file) == size; });
+    if(written > 0)
+    {
+        ok = ok && fflush(file) == 0;
+        if(!ok) failed.store(true, std::memory_order_release);
+        flushed.store(ring.consumedPosition(), std::memory_order_release);
+        // lock makes sure that waiting flush() either sees new position or gets notification
+        std::lock_guard<std::mutex> lock(flushMutex);
+        flushedChanged.notify_all();
+    }
+    return written;
+}
+
+void Serialization::RingBufferFileSink::run()
+{
+    while(!stopping.load(std::memory_order_acquire))
+    {
+        if(drain() == 0) std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    // producers may still publish reserved records
+    while(ring.consumedPosition() != ring.reservedPosition())
+    {
+        if(drain() == 0) std::this_thread::yield();
+    }
+}
+
+void Serialization::RingBufferFileSink::flush()
+{
+    uint64_t target = ring.reservedPosition();
+    std::unique_lock<std::mutex> lock(flushMutex);
+    flushedChanged.wait(lock, [this, target] { return flushed.load(std::memory_order_acquire) >= target; });
+    if(hasFailed()) throw SerializerExceptions::InvalidArgs{"RingBufferFileSink::flush() - can't write to file"};
+}
@@ -0,0 +1,200 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>
+#include "serializer.hpp"
+
+namespace Serialization
+{
+    /*
+        Lock-free multi-producer single-consumer ring buffer of serialized records.
+        Producer reserves exact space for its record with one CAS, writes record there and publishes it with one atomic store.
+        Consumer reads published records in order of reservation and frees their space.
+        Record occupies 8-byte header and its data aligned to 8 bytes. Record that doesn't fit before the end of buffer
+        is placed at the beginning, and the rest of buffer is marked as padding.
+    */
+    class RingBuffer
+    {
+    public:
+        // capacity is rounded up to power of two
+        explicit RingBuffer(size_t capacity);
+
+        // copies record to buffer, returns false if there is not enough free space now
+        bool tryPush(const char* data, size_t size);
+
+        /*
+            Serializes arguments as one record.
+            If all arguments have DirectLayout(arithmetic values, strings, pairs and std containers of them),
+            record size is computed first, space is reserved and values are written straight to the ring.
+            User types and wrappers with own encodings(VarintWrapper, vector<bool> and so on) can't be sized without serializing them,
+            so such record is serialized in private thread local buffer first and copied to the ring.
+            Returns false if there is not enough free space now.
+        */
+        template<typename... Args>
+        bool tryWrite(Args*... args)
+        {
+            if constexpr((HasDirectLayout<Args>::value && ...))
+            {
+                return tryStore(recordSize(args...), args...);
+            }
+            else
+            {
+                const std::string& buf = serializeToScratch(args...);
+                return tryPush(buf.data(), buf.size());
+            }
+        }
+
+        // the same as tryWrite, but waits until there is free space
+        template<typename... Args>
+        void write(Args*... args)
+        {
+            // size is computed or record is serialized once, not on every try
+            if constexpr((HasDirectLayout<Args>::value && ...))
+            {
+                BytesCount size = recordSize(args...);
+                while(!tryStore(size, args...)) std::this_thread::yield();
+            }
+            else
+            {
+                const std::string& buf = serializeToScratch(args...);
+                while(!tryPush(buf.data(), buf.size())) std::this_thread::yield();
+            }
+        }
+
+        /*
+            Passes published records to 'callback(const char* data, size_t size)' in order and frees their space.
+            Stops at the first record that is reserved but not published yet.
+            Only one thread may consume. Returns number of consumed records.
+        */
+        template<typename F>
+        size_t consume(F callback, size_t maxRecords = SIZE_MAX)
+        {
+            uint64_t start = tail.load(std::memory_order_relaxed);
+            uint64_t t = start;
+            size_t consumed = 0;
+            // consumed bytes are zeroed only at the end, so the loop must not make a full lap
+            while(consumed < maxRecords && t - start < capacity)
+            {
+                uint64_t header = loadHeader(t);
+                if(!(header & Published)) break;
+                uint64_t size = header >> FlagBits;
+                if(header & Padding)
+                {
+                    t += size;
+                    continue;
+                }
+                callback(bytes() + (t & mask) + HeaderSize, static_cast<size_t>(size));
+                t += HeaderSize + alignedSize(size);
+                ++consumed;
+            }
+            release(start, t);
+            return consumed;
+        }
+
+        inline size_t getCapacity() const { return capacity; }
+        // the biggest record that can be pushed
+        inline size_t maxRecordSize() const { return capacity / 2 - HeaderSize; }
+        // total bytes reserved and freed since creation, buffer is empty when they are equal
+        inline uint64_t reservedPosition() const { return head.load(std::memory_order_acquire); }
+        inline uint64_t consumedPosition() const { return tail.load(std::memory_order_acquire); }
+
+    private:
+        static constexpr uint64_t HeaderSize = 8;
+        static constexpr uint64_t Published = 1;
+        static constexpr uint64_t Padding = 2;
+        static constexpr uint64_t FlagBits = 2;
+
+        static inline uint64_t alignedSize(uint64_t size) { return (size + 7) & ~uint64_t(7); }
+        inline char* bytes() { return reinterpret_cast<char*>(words.get()); }
+        inline char* recordData(uint64_t position) { return bytes() + (position & mask) + HeaderSize; }
+
+        template<typename... Args>
+        static BytesCount recordSize(Args*... args)
+        {
+            return (BytesCount(0) + ... + DirectLayout<Args>::size(args));
+        }
+
+        // reserves exactly 'size' bytes and writes arguments there
+        template<typename... Args>
+        bool tryStore(BytesCount size, Args*... args)
+        {
+            uint64_t position;
+            if(!tryReserve(size, &position)) return false;
+            char* out = recordData(position);
+            ((out = DirectLayout<Args>::store(out, args)), ...);
+            publish(position, size);
+            return true;
+        }
+
+        template<typename... Args>
+        static const std::string& serializeToScratch(Args*... args)
+        {
+            std::string& buf = scratchBuffer();
+            buf.clear();
+            Serializer::serializeAll(buf, args...);
+            return buf;
+        }
+
+        // thread local buffer of ring buffers, it is not shared with SerializationContext
+        static std::string& scratchBuffer();
+        // reserves space for record of 'size' bytes, returns false if there is not enough free space now
+        bool tryReserve(size_t size, uint64_t* position);
+        // makes record visible to consumer
+        inline void publish(uint64_t position, size_t size) { storeHeader(position, uint64_t(size) << FlagBits | Published); }
+        uint64_t loadHeader(uint64_t position) const;
+        void storeHeader(uint64_t position, uint64_t header);
+        // zeroes consumed bytes, so they are not taken for published headers later, and gives them back to producers
+        void release(uint64_t from, uint64_t to);
+
+        size_t capacity;
+        uint64_t mask;
+        std::unique_ptr<uint64_t[]> words;
+        // producers reserve space at 'head', consumer frees it at 'tail', both only grow
+        alignas(64) std::atomic<uint64_t> head;
+        alignas(64) std::atomic<uint64_t> tail;
+    };
+
+    /*
+        Writes records from ring buffer to file in background thread.
+        Records are written one after another(as serializeAll writes them), stdio buffer makes writes batched.
+    */
+    class RingBufferFileSink
+    {
+    public:
+        // throws InvalidArgs if file can't be opened
+        RingBufferFileSink(const std::string& path, size_t capacity);
+        // writes all published records and closes file
+        ~RingBufferFileSink();
+
+        template<typename... Args>
+        bool tryWrite(Args*... args) { return ring.tryWrite(args...); }
+
+        template<typename... Args>
+        void write(Args*... args) { ring.write(args...); }
+
+        /*
+            Waits until all records written before this call are in file.
+            Throws InvalidArgs if writing to file failed(for example, disk is full), records are dropped after that.
+        */
+        void flush();
+
+        inline bool hasFailed() const { return failed.load(std::memory_order_acquire); }
+
+        inline RingBuffer& getRing() { return ring; }
+
+    private:
+        void run();
+        size_t drain();
+
+        RingBuffer ring;
+        FILE* file;
+        std::atomic<bool> stopping;
+        std::atomic<bool> failed;
+        std::atomic<uint64_t> flushed;
+        std::mutex flushMutex;
+        std::condition_variable flushedChanged;
+        std::thread consumer;
+    };
+}
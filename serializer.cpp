@@ -1,5 +1,12 @@
 #include "serializer.hpp"
 #include <iostream>
+#include <cmath>
+#include <atomic>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define SERIALIZER_HAS_SSE42_CRC
+#define SERIALIZER_HAS_X86_SIMD
+#endif
 
 Serialization::SerializerExceptions::InvalidType::InvalidType(const std::string& err)
     : std::runtime_error{err} {}
@@ -7,6 +14,12 @@ Serialization::SerializerExceptions::InvalidType::InvalidType(const std::string&
 Serialization::SerializerExceptions::InvalidArgs::InvalidArgs(const std::string& err)
     : std::runtime_error{err} {}
 
+Serialization::SerializerExceptions::OutOfBounds::OutOfBounds(const std::string& err)
+    : std::runtime_error{err} {}
+
+Serialization::SerializerExceptions::ChecksumMismatch::ChecksumMismatch(const std::string& err)
+    : std::runtime_error{err} {}
+
 
 void Serialization::MultipleSerializable::registerSerializer(SerializerId _id, const SerializerFunction& f)
 {
@@ -30,3 +43,906 @@ const Serialization::DeserializerFunction& Serialization::MultipleDeserializable
 {
     return dsmap.at(curId);
 }
+
+
+std::string& Serialization::SerializationContext::buffer()
+{
+    current.clear();
+    if(current.capacity() < highWaterMark && !spare.empty())
+    {
+        current.swap(spare.back());
+        spare.pop_back();
+        current.clear();
+    }
+    current.reserve(highWaterMark);
+    return current;
+}
+
+std::string Serialization::SerializationContext::takeBuffer()
+{
+    highWaterMark = std::max<BytesCount>(highWaterMark, current.size());
+    std::string taken;
+    taken.swap(current);
+    return taken;
+}
+
+void Serialization::SerializationContext::recycle(std::string&& buf)
+{
+    if(spare.size() < MaxSpareBuffers) spare.push_back(std::move(buf));
+}
+
+Serialization::SerializationContext& Serialization::SerializationContext::threadLocal()
+{
+    thread_local SerializationContext context;
+    return context;
+}
+
+Serialization::DeserializationContext& Serialization::DeserializationContext::threadLocal()
+{
+    thread_local DeserializationContext context;
+    return context;
+}
+
+
+namespace
+{
+    using Serialization::Crc32c;
+
+    // slicing-by-8 tables for reflected CRC32C polynomial
+    struct Crc32cTables
+    {
+        Crc32cTables()
+        {
+            for(uint32_t i = 0; i < 256; ++i)
+            {
+                uint32_t crc = i;
+                for(int j = 0; j < 8; ++j) crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+                t[0][i] = crc;
+            }
+            for(uint32_t i = 0; i < 256; ++i)
+            {
+                for(int k = 1; k < 8; ++k) t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+            }
+        }
+        uint32_t t[8][256];
+    };
+
+    uint32_t crc32cSoftware(uint32_t crc, const unsigned char* p, size_t size)
+    {
+        static const Crc32cTables tables;
+        const auto& t = tables.t;
+        while(size >= 8)
+        {
+            uint32_t lo, hi;
+            memcpy(&lo, p, 4);
+            memcpy(&hi, p + 4, 4);
+            lo ^= crc;
+            crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+                  t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+            p += 8;
+            size -= 8;
+        }
+        while(size--) crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+        return crc;
+    }
+
+#ifdef SERIALIZER_HAS_SSE42_CRC
+    __attribute__((target("sse4.2")))
+    uint32_t crc32cHardware(uint32_t crc, const unsigned char* p, size_t size)
+    {
+#ifdef __x86_64__
+        uint64_t crc64 = crc;
+        while(size >= 8)
+        {
+            uint64_t v;
+            memcpy(&v, p, 8);
+            crc64 = _mm_crc32_u64(crc64, v);
+            p += 8;
+            size -= 8;
+        }
+        crc = static_cast<uint32_t>(crc64);
+#endif
+        while(size >= 4)
+        {
+            uint32_t v;
+            memcpy(&v, p, 4);
+            crc = _mm_crc32_u32(crc, v);
+            p += 4;
+            size -= 4;
+        }
+        while(size--) crc = _mm_crc32_u8(crc, *p++);
+        return crc;
+    }
+#endif
+
+    typedef uint32_t (*Crc32cFunction)(uint32_t, const unsigned char*, size_t);
+
+    Crc32cFunction selectCrc32c()
+    {
+#ifdef SERIALIZER_HAS_SSE42_CRC
+        if(__builtin_cpu_supports("sse4.2")) return crc32cHardware;
+#endif
+        return crc32cSoftware;
+    }
+
+    // function local static, so compute() works from static initializers of other translation units too
+    Crc32cFunction crc32cImpl()
+    {
+        static const Crc32cFunction impl = selectCrc32c();
+        return impl;
+    }
+}
+
+Crc32c::Checksum Serialization::Crc32c::compute(const void* data, size_t size, Checksum crc)
+{
+    return ~crc32cImpl()(~crc, static_cast<const unsigned char*>(data), size);
+}
+
+Crc32c::Checksum Serialization::Crc32c::computeSoftware(const void* data, size_t size, Checksum crc)
+{
+    return ~crc32cSoftware(~crc, static_cast<const unsigned char*>(data), size);
+}
+
+bool Serialization::Crc32c::isHardwareAccelerated()
+{
+    return crc32cImpl() != crc32cSoftware;
+}
+
+
+namespace
+{
+    using Serialization::VarintCodec;
+
+    template<typename U>
+    inline U zigzagEncode(U v)
+    {
+        typedef std::make_signed_t<U> S;
+        return static_cast<U>(v << 1) ^ static_cast<U>(static_cast<S>(v) >> (sizeof(U) * 8 - 1));
+    }
+
+    template<typename U>
+    inline U zigzagDecode(U v)
+    {
+        return static_cast<U>(v >> 1) ^ static_cast<U>(U(0) - (v & 1));
+    }
+
+    // reads one canonical(shortest) varint, returns false if it is truncated, too long or overflows U
+    template<typename U>
+    inline bool readVarint(const unsigned char*& p, const unsigned char* end, U& out)
+    {
+        constexpr size_t bits = sizeof(U) * 8;
+        constexpr size_t maxBytes = VarintCodec::maxBytes<U>();
+        U v = 0;
+        for(size_t i = 0; i < maxBytes; ++i)
+        {
+            if(p == end) return false;
+            unsigned char b = *p++;
+            if(i == maxBytes - 1 && (b >> (bits - 7 * i)) != 0) return false;
+            v |= static_cast<U>(static_cast<U>(b & 0x7F) << (7 * i));
+            if(!(b & 0x80))
+            {
+                if(b == 0 && i > 0) return false;
+                out = v;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template<typename U>
+    inline unsigned char* writeVarint(unsigned char* p, U v)
+    {
+        while(v >= 0x80)
+        {
+            *p++ = static_cast<unsigned char>(v) | 0x80;
+            v >>= 7;
+        }
+        *p++ = static_cast<unsigned char>(v);
+        return p;
+    }
+
+    /*
+        Block kernels process 'block' values at once if all of them fit in one byte, and return false otherwise.
+    */
+    template<typename U>
+    struct VarintKernels
+    {
+        size_t decodeBlockSize;
+        bool (*decodeBlock)(const unsigned char* in, U* out, bool zigzag);
+        size_t encodeBlockSize;
+        bool (*encodeBlock)(const U* in, unsigned char* out, bool zigzag);
+    };
+
+    template<typename U>
+    size_t decodeVarints(const unsigned char* in, size_t avail, U* out, size_t n, bool zigzag, const VarintKernels<U>& k)
+    {
+        const unsigned char* p = in;
+        const unsigned char* end = in + avail;
+        size_t i = 0;
+        while(i < n)
+        {
+            if(k.decodeBlock && n - i >= k.decodeBlockSize && static_cast<size_t>(end - p) >= k.decodeBlockSize && k.decodeBlock(p, out + i, zigzag))
+            {
+                p += k.decodeBlockSize;
+                i += k.decodeBlockSize;
+                continue;
+            }
+            size_t stop = k.decodeBlock ? std::min(n, i + k.decodeBlockSize) : n;
+            for(; i < stop; ++i)
+            {
+                U v;
+                if(!readVarint(p, end, v)) return VarintCodec::Malformed;
+                out[i] = zigzag ? zigzagDecode(v) : v;
+            }
+        }
+        return p - in;
+    }
+
+    template<typename U>
+    size_t encodeVarints(const U* in, size_t n, unsigned char* out, bool zigzag, const VarintKernels<U>& k)
+    {
+        unsigned char* p = out;
+        size_t i = 0;
+        while(i < n)
+        {
+            if(k.encodeBlock && n - i >= k.encodeBlockSize && k.encodeBlock(in + i, p, zigzag))
+            {
+                p += k.encodeBlockSize;
+                i += k.encodeBlockSize;
+                continue;
+            }
+            size_t stop = k.encodeBlock ? std::min(n, i + k.encodeBlockSize) : n;
+            for(; i < stop; ++i)
+            {
+                p = writeVarint(p, zigzag ? zigzagEncode(in[i]) : in[i]);
+            }
+        }
+        return p - out;
+    }
+
+#ifdef SERIALIZER_HAS_X86_SIMD
+    /*
+        SSE4.1 kernels: 16 one-byte varints are widened to 16-bit, 32-bit or 64-bit lanes and vice versa.
+    */
+    __attribute__((target("sse4.1"))) inline __m128i zigzagDecode16(__m128i x)
+    {
+        return _mm_xor_si128(_mm_srli_epi16(x, 1), _mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(x, _mm_set1_epi16(1))));
+    }
+
+    __attribute__((target("sse4.1"))) inline __m128i zigzagDecode32(__m128i x)
+    {
+        return _mm_xor_si128(_mm_srli_epi32(x, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(x, _mm_set1_epi32(1))));
+    }
+
+    __attribute__((target("sse4.1"))) inline __m128i zigzagDecode64(__m128i x)
+    {
+        return _mm_xor_si128(_mm_srli_epi64(x, 1), _mm_sub_epi64(_mm_setzero_si128(), _mm_and_si128(x, _mm_set1_epi64x(1))));
+    }
+
+    __attribute__((target("sse4.1"))) bool decodeBlockSse41(const unsigned char* in, uint16_t* out, bool zigzag)
+    {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        if(_mm_movemask_epi8(bytes)) return false;
+        __m128i lo = _mm_cvtepu8_epi16(bytes);
+        __m128i hi = _mm_cvtepu8_epi16(_mm_srli_si128(bytes, 8));
+        if(zigzag)
+        {
+            lo = zigzagDecode16(lo);
+            hi = zigzagDecode16(hi);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), hi);
+        return true;
+    }
+
+    __attribute__((target("sse4.1"))) bool decodeBlockSse41(const unsigned char* in, uint32_t* out, bool zigzag)
+    {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        if(_mm_movemask_epi8(bytes)) return false;
+        __m128i v[4] = {_mm_cvtepu8_epi32(bytes), _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 4)),
+                        _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 8)), _mm_cvtepu8_epi32(_mm_srli_si128(bytes, 12))};
+        for(int j = 0; j < 4; ++j)
+        {
+            if(zigzag) v[j] = zigzagDecode32(v[j]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4 * j), v[j]);
+        }
+        return true;
+    }
+
+    __attribute__((target("sse4.1"))) bool decodeBlockSse41(const unsigned char* in, uint64_t* out, bool zigzag)
+    {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        if(_mm_movemask_epi8(bytes)) return false;
+        for(int j = 0; j < 8; ++j)
+        {
+            __m128i v = _mm_cvtepu8_epi64(bytes);
+            if(zigzag) v = zigzagDecode64(v);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * j), v);
+            bytes = _mm_srli_si128(bytes, 2);
+        }
+        return true;
+    }
+
+    __attribute__((target("sse4.1"))) bool encodeBlockSse41(const uint16_t* in, unsigned char* out, bool zigzag)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 8));
+        if(zigzag)
+        {
+            a = _mm_xor_si128(_mm_slli_epi16(a, 1), _mm_srai_epi16(a, 15));
+            b = _mm_xor_si128(_mm_slli_epi16(b, 1), _mm_srai_epi16(b, 15));
+        }
+        if(!_mm_testz_si128(_mm_or_si128(a, b), _mm_set1_epi16(static_cast<short>(0xFF80)))) return false;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(a, b));
+        return true;
+    }
+
+    __attribute__((target("sse4.1"))) bool encodeBlockSse41(const uint32_t* in, unsigned char* out, bool zigzag)
+    {
+        __m128i v[4];
+        __m128i all = _mm_setzero_si128();
+        for(int j = 0; j < 4; ++j)
+        {
+            v[j] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 4 * j));
+            if(zigzag) v[j] = _mm_xor_si128(_mm_slli_epi32(v[j], 1), _mm_srai_epi32(v[j], 31));
+            all = _mm_or_si128(all, v[j]);
+        }
+        if(!_mm_testz_si128(all, _mm_set1_epi32(static_cast<int>(0xFFFFFF80)))) return false;
+        __m128i lo = _mm_packus_epi32(v[0], v[1]);
+        __m128i hi = _mm_packus_epi32(v[2], v[3]);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(lo, hi));
+        return true;
+    }
+
+    /*
+        AVX2 kernels: 32 one-byte varints at once.
+    */
+    __attribute__((target("avx2"))) inline __m256i zigzagDecode16Avx2(__m256i x)
+    {
+        return _mm256_xor_si256(_mm256_srli_epi16(x, 1), _mm256_sub_epi16(_mm256_setzero_si256(), _mm256_and_si256(x, _mm256_set1_epi16(1))));
+    }
+
+    __attribute__((target("avx2"))) inline __m256i zigzagDecode32Avx2(__m256i x)
+    {
+        return _mm256_xor_si256(_mm256_srli_epi32(x, 1), _mm256_sub_epi32(_mm256_setzero_si256(), _mm256_and_si256(x, _mm256_set1_epi32(1))));
+    }
+
+    __attribute__((target("avx2"))) inline __m256i zigzagDecode64Avx2(__m256i x)
+    {
+        return _mm256_xor_si256(_mm256_srli_epi64(x, 1), _mm256_sub_epi64(_mm256_setzero_si256(), _mm256_and_si256(x, _mm256_set1_epi64x(1))));
+    }
+
+    __attribute__((target("avx2"))) bool decodeBlockAvx2(const unsigned char* in, uint16_t* out, bool zigzag)
+    {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+        if(_mm256_movemask_epi8(bytes)) return false;
+        for(int j = 0; j < 2; ++j)
+        {
+            __m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16 * j)));
+            if(zigzag) v = zigzagDecode16Avx2(v);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 16 * j), v);
+        }
+        return true;
+    }
+
+    __attribute__((target("avx2"))) bool decodeBlockAvx2(const unsigned char* in, uint32_t* out, bool zigzag)
+    {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+        if(_mm256_movemask_epi8(bytes)) return false;
+        for(int j = 0; j < 4; ++j)
+        {
+            __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + 8 * j)));
+            if(zigzag) v = zigzagDecode32Avx2(v);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 8 * j), v);
+        }
+        return true;
+    }
+
+    __attribute__((target("avx2"))) bool decodeBlockAvx2(const unsigned char* in, uint64_t* out, bool zigzag)
+    {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+        if(_mm256_movemask_epi8(bytes)) return false;
+        for(int j = 0; j < 8; ++j)
+        {
+            int four;
+            memcpy(&four, in + 4 * j, 4);
+            __m256i v = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(four));
+            if(zigzag) v = zigzagDecode64Avx2(v);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 4 * j), v);
+        }
+        return true;
+    }
+#endif
+
+    VarintCodec::Level detectVarintLevel()
+    {
+#ifdef SERIALIZER_HAS_X86_SIMD
+        if(__builtin_cpu_supports("avx2")) return VarintCodec::Level::AVX2;
+        if(__builtin_cpu_supports("sse4.1")) return VarintCodec::Level::SSE41;
+#endif
+        return VarintCodec::Level::Scalar;
+    }
+
+    // function local statics, so codec works from static initializers of other translation units too
+    VarintCodec::Level supportedVarintLevel()
+    {
+        static const VarintCodec::Level level = detectVarintLevel();
+        return level;
+    }
+
+    // atomic, because setLevel() may be called while other threads encode or decode
+    std::atomic<VarintCodec::Level>& currentVarintLevel()
+    {
+        static std::atomic<VarintCodec::Level> level{supportedVarintLevel()};
+        return level;
+    }
+
+    template<typename U>
+    VarintKernels<U> varintKernels()
+    {
+        VarintKernels<U> k{0, nullptr, 0, nullptr};
+#ifdef SERIALIZER_HAS_X86_SIMD
+        const VarintCodec::Level level = currentVarintLevel().load(std::memory_order_relaxed);
+        if(level == VarintCodec::Level::AVX2) k = VarintKernels<U>{32, decodeBlockAvx2, 0, nullptr};
+        else if(level == VarintCodec::Level::SSE41) k = VarintKernels<U>{16, decodeBlockSse41, 0, nullptr};
+        if constexpr(sizeof(U) <= 4)
+        {
+            // narrowing is memory bound, SSE4.1 kernel is used with AVX2 too
+            if(level != VarintCodec::Level::Scalar)
+            {
+                k.encodeBlockSize = 16;
+                k.encodeBlock = encodeBlockSse41;
+            }
+        }
+#endif
+        return k;
+    }
+}
+
+Serialization::VarintCodec::Level Serialization::VarintCodec::getLevel()
+{
+    return currentVarintLevel().load(std::memory_order_relaxed);
+}
+
+void Serialization::VarintCodec::setLevel(Level level)
+{
+    currentVarintLevel().store(std::min(level, supportedVarintLevel()), std::memory_order_relaxed);
+}
+
+size_t Serialization::VarintCodec::encodeImpl(const uint16_t* in, size_t n, uint8_t* out, bool zigzag)
+{
+    return encodeVarints(in, n, out, zigzag, varintKernels<uint16_t>());
+}
+
+size_t Serialization::VarintCodec::encodeImpl(const uint32_t* in, size_t n, uint8_t* out, bool zigzag)
+{
+    return encodeVarints(in, n, out, zigzag, varintKernels<uint32_t>());
+}
+
+size_t Serialization::VarintCodec::encodeImpl(const uint64_t* in, size_t n, uint8_t* out, bool zigzag)
+{
+    return encodeVarints(in, n, out, zigzag, varintKernels<uint64_t>());
+}
+
+size_t Serialization::VarintCodec::decodeImpl(const uint8_t* in, size_t avail, uint16_t* out, size_t n, bool zigzag)
+{
+    return decodeVarints(in, avail, out, n, zigzag, varintKernels<uint16_t>());
+}
+
+size_t Serialization::VarintCodec::decodeImpl(const uint8_t* in, size_t avail, uint32_t* out, size_t n, bool zigzag)
+{
+    return decodeVarints(in, avail, out, n, zigzag, varintKernels<uint32_t>());
+}
+
+size_t Serialization::VarintCodec::decodeImpl(const uint8_t* in, size_t avail, uint64_t* out, size_t n, bool zigzag)
+{
+    return decodeVarints(in, avail, out, n, zigzag, varintKernels<uint64_t>());
+}
+
+namespace
+{
+    template<typename U>
+    size_t skipVarints(const uint8_t* in, size_t avail, size_t n)
+    {
+        const unsigned char* p = in;
+        const unsigned char* end = in + avail;
+        U v;
+        for(size_t i = 0; i < n; ++i)
+        {
+            if(!readVarint(p, end, v)) return VarintCodec::Malformed;
+        }
+        return static_cast<size_t>(p - in);
+    }
+}
+
+size_t Serialization::VarintCodec::skipImpl(const uint8_t* in, size_t avail, size_t n, uint16_t)
+{
+    return skipVarints<uint16_t>(in, avail, n);
+}
+
+size_t Serialization::VarintCodec::skipImpl(const uint8_t* in, size_t avail, size_t n, uint32_t)
+{
+    return skipVarints<uint32_t>(in, avail, n);
+}
+
+size_t Serialization::VarintCodec::skipImpl(const uint8_t* in, size_t avail, size_t n, uint64_t)
+{
+    return skipVarints<uint64_t>(in, avail, n);
+}
+
+
+namespace
+{
+    using Serialization::FloatSeriesCodec;
+
+    inline uint64_t toBigEndian(uint64_t v)
+    {
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        return __builtin_bswap64(v);
+#elif defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        return v;
+#else
+        uint64_t r;
+        unsigned char* p = reinterpret_cast<unsigned char*>(&r);
+        for(int i = 0; i < 8; ++i) p[i] = static_cast<unsigned char>(v >> (56 - 8 * i));
+        return r;
+#endif
+    }
+
+    inline unsigned leadingZeros(uint64_t v)
+    {
+#ifdef __GNUC__
+        return __builtin_clzll(v);
+#else
+        unsigned n = 0;
+        while(!(v & (uint64_t(1) << 63))) { v <<= 1; ++n; }
+        return n;
+#endif
+    }
+
+    inline unsigned trailingZeros(uint64_t v)
+    {
+#ifdef __GNUC__
+        return __builtin_ctzll(v);
+#else
+        unsigned n = 0;
+        while(!(v & 1)) { v >>= 1; ++n; }
+        return n;
+#endif
+    }
+
+    // writes bits starting from the most significant one, 8 bytes at once
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(unsigned char* _out)
+            : start{_out}, out{_out}, acc{0}, free{64} {}
+
+        // 'n' is in [1, 64], 'v' has no bits set above 'n'
+        inline void write(uint64_t v, unsigned n)
+        {
+            if(n < free)
+            {
+                acc |= v << (free - n);
+                free -= n;
+                return;
+            }
+            unsigned rest = n - free;
+            acc |= v >> rest;
+            uint64_t be = toBigEndian(acc);
+            memcpy(out, &be, sizeof(be));
+            out += sizeof(be);
+            acc = rest ? v << (64 - rest) : 0;
+            free = 64 - rest;
+        }
+
+        // returns bytes written
+        size_t finish()
+        {
+            size_t tail = (64 - free + 7) / 8;
+            uint64_t be = toBigEndian(acc);
+            memcpy(out, &be, tail);
+            return out + tail - start;
+        }
+
+    private:
+        unsigned char* start;
+        unsigned char* out;
+        uint64_t acc;
+        unsigned free;
+    };
+
+    class BitReader
+    {
+    public:
+        BitReader(const unsigned char* _in, size_t _avail)
+            : in{_in}, avail{_avail}, pos{0}, bits{_avail * 8} {}
+
+        // 'n' is in [1, 56]; returns false if input is too short
+        inline bool read(unsigned n, uint64_t& v)
+        {
+            if(n > bits - pos) return false;
+            v = peek() >> (64 - n);
+            pos += n;
+            return true;
+        }
+
+        // 'n' is in [1, 64]
+        inline bool readLong(unsigned n, uint64_t& v)
+        {
+            if(n <= 56) return read(n, v);
+            uint64_t high, low;
+            if(!read(n - 32, high) || !read(32, low)) return false;
+            v = (high << 32) | low;
+            return true;
+        }
+
+        size_t bytesRead() const { return (pos + 7) / 8; }
+
+    private:
+        // next 57 or more bits, aligned to the most significant one
+        inline uint64_t peek() const
+        {
+            size_t byte = pos / 8;
+            uint64_t w = 0;
+            if(avail - byte >= sizeof(w))
+            {
+                memcpy(&w, in + byte, sizeof(w));
+                w = toBigEndian(w);
+            }
+            else
+            {
+                for(size_t i = 0; byte + i < avail; ++i) w |= uint64_t(in[byte + i]) << (56 - 8 * i);
+            }
+            return w << (pos % 8);
+        }
+
+        const unsigned char* in;
+        size_t avail;
+        size_t pos;
+        size_t bits;
+    };
+
+    /*
+        Gorilla encoding. For every value after the first one:
+            '0' - value is the same as previous;
+            '10' + meaningful bits - XOR with previous value fits in window of previous non-zero XOR;
+            '11' + 5 bits of leading zeros count + 5(floats) or 6(doubles) bits of meaningful bits count - 1 + meaningful bits.
+    */
+    template<typename U>
+    size_t encodeXor(const U* in, size_t n, unsigned char* out)
+    {
+        constexpr unsigned width = sizeof(U) * 8;
+        constexpr unsigned lengthBits = width == 64 ? 6 : 5;
+        if(n == 0) return 0;
+        BitWriter w(out);
+        w.write(in[0], width);
+        U prev = in[0];
+        // no window before first non-zero XOR
+        unsigned prevLeading = width + 1;
+        unsigned prevTrailing = 0;
+        for(size_t i = 1; i < n; ++i)
+        {
+            U x = in[i] ^ prev;
+            prev = in[i];
+            if(x == 0)
+            {
+                w.write(0, 1);
+                continue;
+            }
+            unsigned leading = std::min(leadingZeros(x) - (64 - width), 31u);
+            unsigned trailing = trailingZeros(x);
+            if(leading >= prevLeading && trailing >= prevTrailing)
+            {
+                w.write(2, 2);
+                w.write(x >> prevTrailing, width - prevLeading - prevTrailing);
+            }
+            else
+            {
+                unsigned length = width - leading - trailing;
+                w.write((uint64_t(3) << (5 + lengthBits)) | (leading << lengthBits) | (length - 1), 2 + 5 + lengthBits);
+                w.write(x >> trailing, length);
+                prevLeading = leading;
+                prevTrailing = trailing;
+            }
+        }
+        return w.finish();
+    }
+
+    template<typename U>
+    size_t decodeXor(const unsigned char* in, size_t avail, U* out, size_t n)
+    {
+        constexpr unsigned width = sizeof(U) * 8;
+        constexpr unsigned lengthBits = width == 64 ? 6 : 5;
+        if(n == 0) return 0;
+        BitReader r(in, avail);
+        uint64_t v;
+        if(!r.readLong(width, v)) return FloatSeriesCodec::Malformed;
+        U prev = static_cast<U>(v);
+        out[0] = prev;
+        unsigned leading = width + 1;
+        unsigned trailing = 0;
+        for(size_t i = 1; i < n; ++i)
+        {
+            if(!r.read(1, v)) return FloatSeriesCodec::Malformed;
+            if(v != 0)
+            {
+                if(!r.read(1, v)) return FloatSeriesCodec::Malformed;
+                if(v != 0)
+                {
+                    if(!r.read(5 + lengthBits, v)) return FloatSeriesCodec::Malformed;
+                    leading = static_cast<unsigned>(v >> lengthBits);
+                    unsigned length = static_cast<unsigned>(v & ((1u << lengthBits) - 1)) + 1;
+                    if(leading + length > width) return FloatSeriesCodec::Malformed;
+                    trailing = width - leading - length;
+                }
+                else if(leading > width)
+                {
+                    return FloatSeriesCodec::Malformed;
+                }
+                if(!r.readLong(width - leading - trailing, v)) return FloatSeriesCodec::Malformed;
+                prev ^= static_cast<U>(v << trailing);
+            }
+            out[i] = prev;
+        }
+        return r.bytesRead();
+    }
+
+    // conversion of double, that is out of float range, is undefined
+    template<typename T>
+    inline T fromDouble(double v)
+    {
+        if constexpr(std::is_same<T, float>::value)
+        {
+            if(std::fabs(v) > std::numeric_limits<float>::max()) return v > 0 ? std::numeric_limits<float>::infinity() : -std::numeric_limits<float>::infinity();
+        }
+        return static_cast<T>(v);
+    }
+
+    // values are rounded to multiples of 2 * maxError, differences of them are written as zigzag varints
+    template<typename T>
+    size_t encodeQuantizedValues(const T* in, size_t n, double maxError, unsigned char* out)
+    {
+        // rounded values must fit in FloatSeriesCodec::maxBytes<T>() as varints, and be exact in double
+        constexpr double limit = sizeof(T) == 4 ? 1099511627776.0 : 4503599627370496.0;
+        if(!(maxError > 0) || maxError == std::numeric_limits<double>::infinity()) return FloatSeriesCodec::Malformed;
+        double step = 2 * maxError;
+        double inverseStep = 1 / step;
+        unsigned char* p = out;
+        int64_t prev = 0;
+        for(size_t i = 0; i < n; ++i)
+        {
+            double q = std::round(in[i] * inverseStep);
+            if(!(std::fabs(q) < limit)) return FloatSeriesCodec::Malformed;
+            // rounding of step itself may add error, so it is checked
+            if(!(std::fabs(static_cast<double>(fromDouble<T>(q * step)) - in[i]) <= maxError)) return FloatSeriesCodec::Malformed;
+            int64_t current = static_cast<int64_t>(q);
+            p = writeVarint(p, zigzagEncode(static_cast<uint64_t>(current) - static_cast<uint64_t>(prev)));
+            prev = current;
+        }
+        return p - out;
+    }
+
+    template<typename T>
+    size_t decodeQuantizedValues(const unsigned char* in, size_t avail, double maxError, T* out, size_t n)
+    {
+        double step = 2 * maxError;
+        const unsigned char* p = in;
+        const unsigned char* end = in + avail;
+        uint64_t current = 0;
+        for(size_t i = 0; i < n; ++i)
+        {
+            uint64_t delta;
+            if(!readVarint(p, end, delta)) return FloatSeriesCodec::Malformed;
+            current += zigzagDecode(delta);
+            out[i] = fromDouble<T>(static_cast<double>(static_cast<int64_t>(current)) * step);
+        }
+        return p - in;
+    }
+}
+
+size_t Serialization::FloatSeriesCodec::encode(const float* in, size_t n, uint8_t* out)
+{
+    return encodeXor(reinterpret_cast<const uint32_t*>(in), n, out);
+}
+
+size_t Serialization::FloatSeriesCodec::encode(const double* in, size_t n, uint8_t* out)
+{
+    return encodeXor(reinterpret_cast<const uint64_t*>(in), n, out);
+}
+
+size_t Serialization::FloatSeriesCodec::decode(const uint8_t* in, size_t avail, float* out, size_t n)
+{
+    return decodeXor(in, avail, reinterpret_cast<uint32_t*>(out), n);
+}
+
+size_t Serialization::FloatSeriesCodec::decode(const uint8_t* in, size_t avail, double* out, size_t n)
+{
+    return decodeXor(in, avail, reinterpret_cast<uint64_t*>(out), n);
+}
+
+size_t Serialization::FloatSeriesCodec::encodeQuantized(const float* in, size_t n, double maxError, uint8_t* out)
+{
+    return encodeQuantizedValues(in, n, maxError, out);
+}
+
+size_t Serialization::FloatSeriesCodec::encodeQuantized(const double* in, size_t n, double maxError, uint8_t* out)
+{
+    return encodeQuantizedValues(in, n, maxError, out);
+}
+
+size_t Serialization::FloatSeriesCodec::decodeQuantized(const uint8_t* in, size_t avail, double maxError, float* out, size_t n)
+{
+    return decodeQuantizedValues(in, avail, maxError, out, n);
+}
+
+size_t Serialization::FloatSeriesCodec::decodeQuantized(const uint8_t* in, size_t avail, double maxError, double* out, size_t n)
+{
+    return decodeQuantizedValues(in, avail, maxError, out, n);
+}
+
+
+void Serialization::ScatterGatherBuffer::append(const void* data, size_t size)
+{
+    if(size < threshold)
+    {
+        scratchBuf.append(static_cast<const char*>(data), size);
+        return;
+    }
+    if(scratchBuf.size() > scratchStart) parts.push_back(Part{nullptr, scratchStart, scratchBuf.size() - scratchStart});
+    parts.push_back(Part{static_cast<const char*>(data), 0, size});
+    scratchStart = scratchBuf.size();
+}
+
+std::vector<Serialization::ScatterGatherBuffer::Segment> Serialization::ScatterGatherBuffer::segments() const
+{
+    std::vector<Segment> result;
+    result.reserve(parts.size() + 1);
+    // scratch buffer may be reallocated while it grows, so its parts are resolved only now
+    for(const Part& part : parts)
+    {
+        result.push_back(Segment{part.data ? part.data : scratchBuf.data() + part.offset, part.size});
+    }
+    if(scratchBuf.size() > scratchStart) result.push_back(Segment{scratchBuf.data() + scratchStart, scratchBuf.size() - scratchStart});
+    return result;
+}
+
+#ifdef SERIALIZER_HAS_IOVEC
+std::vector<iovec> Serialization::ScatterGatherBuffer::iovecs() const
+{
+    std::vector<iovec> result;
+    for(const Segment& segment : segments())
+    {
+        result.push_back(iovec{const_cast<char*>(segment.data), segment.size});
+    }
+    return result;
+}
+#endif
+
+Serialization::BytesCount Serialization::ScatterGatherBuffer::size() const
+{
+    BytesCount total = scratchBuf.size();
+    for(const Part& part : parts)
+    {
+        if(part.data) total += part.size;
+    }
+    return total;
+}
+
+std::string Serialization::ScatterGatherBuffer::flatten() const
+{
+    std::string result;
+    result.reserve(size());
+    for(const Segment& segment : segments())
+    {
+        result.append(segment.data, segment.size);
+    }
+    return result;
+}
+
+void Serialization::ScatterGatherBuffer::clear()
+{
+    scratchBuf.clear();
+    parts.clear();
+    scratchStart = 0;
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include <functional>
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <vector>
 #include <list>
@@ -9,7 +10,29 @@
 #include <set>
 #include <unordered_set>
 #include <deque>
+#include <algorithm>
+#include <stdexcept>
+#include <memory>
+#include <atomic>
+#include <typeindex>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <limits>
+#include <tuple>
+#include <utility>
+#if __cplusplus >= 202002L
+#include <span>
+#endif
 #include <memory.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/uio.h>
+#define SERIALIZER_HAS_IOVEC
+#endif
+// libstdc++ keeps std::vector<bool> in words with bits from the lowest one, on little endian machine it is the packed format as is
+#if defined(__GLIBCXX__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SERIALIZER_HAS_BOOL_VECTOR_WORDS
+#endif
 
 // using void_t with all template arguments as void
 template< class... >
@@ -98,12 +121,26 @@ template<typename T, typename... Others>
 struct IsUnorderedMultiset<std::unordered_multiset<T, Others...>> : std::true_type{};
 
 
+template<typename T>
+struct IsBoolVector : std::false_type {};
+
+template<typename... Others>
+struct IsBoolVector<std::vector<bool, Others...>> : std::true_type{};
+
 template<typename T>
 struct IsString : std::false_type {};
 
 template<>
 struct IsString<std::string> : std::true_type{};
 
+template<typename T>
+struct IsSpan : std::false_type {};
+
+#if __cplusplus >= 202002L
+template<typename T>
+struct IsSpan<std::span<T>> : std::true_type{};
+#endif
+
 
 /*
     Not usual serializator, it works as:
@@ -136,14 +173,27 @@ namespace Serialization
         {
             InvalidArgs(const std::string& err);
         };
+        // thrown when deserializer tries to read past the end of buffer(truncated or corrupted data)
+        struct OutOfBounds : std::runtime_error
+        {
+            OutOfBounds(const std::string& err);
+        };
+        // thrown when checksum of deserialized data doesn't match stored one
+        struct ChecksumMismatch : std::runtime_error
+        {
+            ChecksumMismatch(const std::string& err);
+        };
     };
 
 
     /*
         Contains template structs that help serialize std containers.
+        ContainerAdder<T> adds deserialized elements to container: 'prepare' is called with number of elements before adding(if elements can't be empty,
+        the number is never bigger than remaining bytes of buffer can hold), 'addTo' for every element and 'finish' after the last one.
     */
     class ContainerSerializerHelper
     {
+    public:
         template<typename T, typename Check = void>
         struct ContainerAdder;
     };
@@ -154,460 +204,2973 @@ namespace Serialization
         template<typename Val>
         static void addTo(T* cont, Val* val)
         {
-            cont->push_back(*val);
+            cont->push_back(std::move(*val));
         }
+
+        static void prepare(T*, ElementsCount) {}
+        static void finish(T*) {}
     };
 
     template<typename T>
     struct ContainerSerializerHelper::ContainerAdder<T, std::enable_if_t<IsMap<T>::value || IsMultimap<T>::value ||
-                                                                         IsUndorderedMap<T>::value || IsUndorderedMultimap<T>::value ||
-                                                                         IsSet<T>::value || IsMultiset<T>::value ||
+                                                                         IsSet<T>::value || IsMultiset<T>::value>>
+    {
+        template<typename Val>
+        // 'val' is std::pair here
+        static void addTo(T* cont, Val* val)
+        {
+            // serialized ordered containers are sorted, so hint makes insertion amortized constant
+            cont->insert(cont->end(), std::move(*val));
+        }
+
+        static void prepare(T*, ElementsCount) {}
+        static void finish(T*) {}
+    };
+
+    template<typename T>
+    struct ContainerSerializerHelper::ContainerAdder<T, std::enable_if_t<IsUndorderedMap<T>::value || IsUndorderedMultimap<T>::value ||
                                                                          IsUnorderedSet<T>::value || IsUnorderedMultiset<T>::value>>
     {
         template<typename Val>
         // 'val' is std::pair here
         static void addTo(T* cont, Val* val)
         {
-            cont->insert(*val);
+            cont->insert(std::move(*val));
+        }
+
+        // avoids rehashing while table grows; table that is already big enough(reused or pre-sized) is kept
+        static void prepare(T* cont, ElementsCount count)
+        {
+            if(count > cont->bucket_count() * cont->max_load_factor()) cont->reserve(count);
         }
+
+        static void finish(T*) {}
+    };
+
+    /*
+        Type in which container element is deserialized before it is added to container.
+        Maps have std::pair<const Key, Value> as value type, const is removed to move key into container instead of copying.
+    */
+    template<typename T>
+    struct DecodedValueType
+    {
+        typedef std::remove_const_t<T> type;
+    };
+
+    template<typename T1, typename T2>
+    struct DecodedValueType<std::pair<T1, T2>>
+    {
+        typedef std::pair<std::remove_const_t<T1>, T2> type;
     };
 
+    /*
+        Deserializer of T assigns the whole value(arithmetic values, strings, containers, pairs of them),
+        so existing object can be decoded in place and keeps its memory.
+        Deserializers of user types may leave members they don't read, such objects are reset before reuse.
+    */
+    template<typename T, typename = void>
+    struct IsFullyDeserialized : std::is_arithmetic<T> {};
+
+    template<typename T>
+    struct IsFullyDeserialized<T, std::enable_if_t<IsIterable<T>::value>> : std::true_type {};
+
+    template<typename T1, typename T2>
+    struct IsFullyDeserialized<std::pair<T1, T2>> : std::integral_constant<bool, IsFullyDeserialized<std::remove_const_t<T1>>::value && IsFullyDeserialized<T2>::value> {};
+
 
     /*
         Array serialization helper.
         To array be serialized correctly, it MUST be wrapped in this structure.
+        'capacity' is the number of elements that memory pointed by 'start' can hold, deserializer never writes more.
     */
     template<typename T>
     struct ArrayWrapper
     {
         ArrayWrapper()
-            : start{nullptr}, size{0} {}
+            : start{nullptr}, size{0}, capacity{0} {}
         ArrayWrapper(T* _start, ElementsCount _size)
-            : start{_start}, size{_size} {}
+            : start{_start}, size{_size}, capacity{_size} {}
+        ArrayWrapper(T* _start, ElementsCount _size, ElementsCount _capacity)
+            : start{_start}, size{_size}, capacity{_capacity} {}
         T* start;
         ElementsCount size;
+        ElementsCount capacity;
     };
 
-
     /*
-        This class must be inherited if object wants to be serializable and has single serializer;
+        Array wrapper that owns its memory.
+        On deserialization it allocates array of needed size itself(if current capacity is not enough).
     */
-    class Serializable
+    template<typename T>
+    struct OwningArrayWrapper : public ArrayWrapper<T>
     {
-    public:
-        virtual BytesCount serialize(std::string& buf) = 0;
+        OwningArrayWrapper() = default;
+        explicit OwningArrayWrapper(ElementsCount _capacity)
+            : ArrayWrapper<T>{nullptr, 0, _capacity}, storage{new T[_capacity]}
+        {
+            this->start = storage.get();
+        }
+
+        void reallocate(ElementsCount _capacity)
+        {
+            storage.reset(new T[_capacity]);
+            this->start = storage.get();
+            this->capacity = _capacity;
+        }
+
+        std::unique_ptr<T[]> storage;
     };
 
+
     /*
-        This class must be inherited if object wants to be deserializable and has single serializer;
+        Opt-in compact encoding for vectors of 16, 32 and 64-bit integers.
+        Every element is written as LEB128 varint(signed ones are zigzag encoded), so small values take 1-2 bytes instead of sizeof(T).
     */
-    class Deserializable
+    template<typename T>
+    struct VarintWrapper
     {
-        virtual BytesCount deserialize(const std::string& buf, BytesCount offset) = 0;
+        VarintWrapper()
+            : cont{nullptr} {}
+        VarintWrapper(std::vector<T>* _cont)
+            : cont{_cont} {}
+        std::vector<T>* cont;
     };
 
     /*
-        This class must be inherited if object wants to be serializable and has multiple serializers;
-        This object should have map of serializers, from which needed serializer will be selected by 'id'.
+        Varint encoder/decoder for arrays of integers.
+        Blocks of values that fit in one byte are narrowed/widened with SSE4.1 or AVX2 instructions(chosen at runtime),
+        everything else is processed by scalar code.
     */
-    class MultipleSerializable
+    class VarintCodec
     {
     public:
-        typedef std::unordered_map<SerializerId, SerializerFunction> SerializersMap;
+        enum class Level { Scalar, SSE41, AVX2 };
+        static constexpr size_t Malformed = SIZE_MAX;
 
-        inline BytesCount serialize(std::string& buf) { return getCurrentSerializer()(buf); }
-        void registerSerializer(SerializerId _id, const SerializerFunction& f);
-        // throws if not have such Id
-        const SerializerFunction& getCurrentSerializer();
-        inline void setSerializerId(SerializerId _id) { curId = _id; }
-        inline SerializerId getSerializerId() const { return curId; }
+        template<typename T>
+        static constexpr size_t maxBytes() { return (sizeof(T) * 8 + 6) / 7; }
+
+        // 'out' must have room for n * maxBytes<T>() bytes; returns bytes written
+        template<typename T>
+        static size_t encode(const T* in, size_t n, uint8_t* out)
+        {
+            return encodeImpl(reinterpret_cast<const typename FixedWidth<T>::type*>(in), n, out, std::is_signed<T>::value);
+        }
+
+        // reads n values from at most 'avail' bytes; returns bytes read or Malformed if input is too short or is not valid
+        template<typename T>
+        static size_t decode(const uint8_t* in, size_t avail, T* out, size_t n)
+        {
+            return decodeImpl(in, avail, reinterpret_cast<typename FixedWidth<T>::type*>(out), n, std::is_signed<T>::value);
+        }
 
+        // checks n values in at most 'avail' bytes without storing them; returns bytes they take or Malformed
+        template<typename T>
+        static size_t skip(const uint8_t* in, size_t avail, size_t n)
+        {
+            return skipImpl(in, avail, n, typename FixedWidth<T>::type{});
+        }
+
+        static Level getLevel();
+        // for tests and benchmarks, level is never raised above the one processor supports; safe to call while other threads encode or decode
+        static void setLevel(Level level);
 
     private:
-        SerializersMap smap;
-        SerializerId curId;
+        template<typename T>
+        struct FixedWidth
+        {
+            static_assert(std::is_integral<T>::value && (sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8), "VarintCodec supports only 16, 32 and 64-bit integers");
+            typedef std::make_unsigned_t<T> type;
+            static_assert(std::is_same<type, uint16_t>::value || std::is_same<type, uint32_t>::value || std::is_same<type, uint64_t>::value, "use fixed width integer types");
+        };
+
+        static size_t encodeImpl(const uint16_t* in, size_t n, uint8_t* out, bool zigzag);
+        static size_t encodeImpl(const uint32_t* in, size_t n, uint8_t* out, bool zigzag);
+        static size_t encodeImpl(const uint64_t* in, size_t n, uint8_t* out, bool zigzag);
+        static size_t decodeImpl(const uint8_t* in, size_t avail, uint16_t* out, size_t n, bool zigzag);
+        static size_t decodeImpl(const uint8_t* in, size_t avail, uint32_t* out, size_t n, bool zigzag);
+        static size_t decodeImpl(const uint8_t* in, size_t avail, uint64_t* out, size_t n, bool zigzag);
+        static size_t skipImpl(const uint8_t* in, size_t avail, size_t n, uint16_t);
+        static size_t skipImpl(const uint8_t* in, size_t avail, size_t n, uint32_t);
+        static size_t skipImpl(const uint8_t* in, size_t avail, size_t n, uint64_t);
     };
 
+
     /*
-        This class must be inherited if object wants to be deserializable and has multiple serializers;
-        This object should have map of deserializers, from which needed deserializer will be selected by 'id'.
+        Opt-in compact encoding for slowly changing series of floating point values(std::vector, ArrayWrapper or OwningArrayWrapper of float or double).
+        By default values are XOR-ed with previous ones and only meaningful bits are written(Gorilla encoding), this is lossless.
+        If 'maxError' is positive, values are rounded to multiples of 2 * maxError and differences of them are written as varints,
+        so every decoded value differs from original one by at most 'maxError'.
+        If some value can't be rounded(inf, nan, too large for such error) the whole series is written losslessly.
     */
-    class MultipleDeserializable
+    template<typename Cont>
+    struct FloatSeriesWrapper
     {
-    public:
-        typedef std::unordered_map<SerializerId, DeserializerFunction> DeserializersMap;
-
-        inline BytesCount deserialize(const std::string& buf, BytesCount offset) { return getCurrentDeserializer()(buf, offset); }
-        void registerDeserializer(SerializerId _id, const DeserializerFunction& f);
-        // throws if not have such Id
-        const DeserializerFunction& getCurrentDeserializer();
-
-        inline void setDeserializerId(SerializerId _id) { curId = _id; }
-
-        inline SerializerId getDeserializerId() const { return curId; }
-
-    private:
-        DeserializersMap dsmap;
-        SerializerId curId;
+        FloatSeriesWrapper()
+            : cont{nullptr}, maxError{0} {}
+        FloatSeriesWrapper(Cont* _cont, double _maxError = 0)
+            : cont{_cont}, maxError{_maxError} {}
+        Cont* cont;
+        double maxError;
     };
 
-
-    // checks for custorm type
-    template<typename T, typename = void>
-    struct IsSerializable : std::false_type {};
+    // gives access to elements of contiguous containers of arithmetic values
+    template<typename Cont>
+    struct ContiguousStorage;
 
     template<typename T>
-    struct IsSerializable<T, std::enable_if_t<std::is_base_of<Serializable, T>::value>> : std::true_type {};
+    struct ContiguousStorage<std::vector<T>>
+    {
+        typedef T ValueType;
+        static const T* data(const std::vector<T>* cont) { return cont->data(); }
+        static ElementsCount size(const std::vector<T>* cont) { return cont->size(); }
+        static T* prepare(std::vector<T>* cont, ElementsCount count)
+        {
+            cont->resize(count);
+            return cont->data();
+        }
+    };
 
-    template<typename T, typename = void>
-    struct IsDeserializable : std::false_type {};
+    template<typename T>
+    struct ContiguousStorage<ArrayWrapper<T>>
+    {
+        typedef T ValueType;
+        static const T* data(const ArrayWrapper<T>* cont) { return cont->start; }
+        static ElementsCount size(const ArrayWrapper<T>* cont) { return cont->size; }
+        static T* prepare(ArrayWrapper<T>* cont, ElementsCount count)
+        {
+            if(cont->start == nullptr || count > cont->capacity) throw SerializerExceptions::InvalidArgs{"ContiguousStorage<ArrayWrapper>::prepare() - array capacity is too small"};
+            cont->size = count;
+            return cont->start;
+        }
+    };
 
     template<typename T>
-    struct IsDeserializable<T, std::enable_if_t<std::is_base_of<Deserializable, T>::value>> : std::true_type {};
+    struct ContiguousStorage<OwningArrayWrapper<T>> : ContiguousStorage<ArrayWrapper<T>>
+    {
+        static T* prepare(OwningArrayWrapper<T>* cont, ElementsCount count)
+        {
+            if(cont->start == nullptr || count > cont->capacity) cont->reallocate(count);
+            cont->size = count;
+            return cont->start;
+        }
+    };
 
-    template<typename T, typename = void>
-    struct IsMultipleSerializable : std::false_type {};
+    /*
+        Encoder/decoder for FloatSeriesWrapper.
+    */
+    class FloatSeriesCodec
+    {
+    public:
+        static constexpr size_t Malformed = SIZE_MAX;
+
+        // upper bound of encoded size of 'n' values in any mode
+        template<typename T>
+        static constexpr size_t maxBytes(size_t n) { return n * (sizeof(T) + 2) + 8; }
+
+        // lossless XOR encoding; 'out' must have room for maxBytes<T>(n) bytes; returns bytes written
+        static size_t encode(const float* in, size_t n, uint8_t* out);
+        static size_t encode(const double* in, size_t n, uint8_t* out);
+        // reads n values from at most 'avail' bytes; returns bytes read or Malformed if input is too short
+        static size_t decode(const uint8_t* in, size_t avail, float* out, size_t n);
+        static size_t decode(const uint8_t* in, size_t avail, double* out, size_t n);
+
+        // returns Malformed if some value can't be rounded with such error
+        static size_t encodeQuantized(const float* in, size_t n, double maxError, uint8_t* out);
+        static size_t encodeQuantized(const double* in, size_t n, double maxError, uint8_t* out);
+        static size_t decodeQuantized(const uint8_t* in, size_t avail, double maxError, float* out, size_t n);
+        static size_t decodeQuantized(const uint8_t* in, size_t avail, double maxError, double* out, size_t n);
+    };
 
-    template<typename T>
-    struct IsMultipleSerializable<T, std::enable_if_t<std::is_base_of<MultipleSerializable, T>::value>> : std::true_type {};
 
-    template<typename T, typename = void>
-    struct IsMultipleDeserializable : std::false_type {};
+    /*
+        Key with its hash value, that is serialized next to it.
+        Containers that use PrecomputedHash as hasher take hash from key instead of computing it, so after deserialization keys are not hashed again.
+        WARNING! Hash values are stored, so writer and reader must use the same 'Hash'(std::hash may differ between standard libraries).
+    */
+    template<typename Key, typename Hash = std::hash<Key>>
+    struct HashedKey
+    {
+        HashedKey()
+            : value{}, hash{emptyHash()} {}
+        HashedKey(Key _value)
+            : value{std::move(_value)}, hash{Hash{}(value)} {}
+        HashedKey(const char* _value)
+            : HashedKey{Key(_value)} {}
 
-    template<typename T>
-    struct IsMultipleDeserializable<T, std::enable_if_t<std::is_base_of<MultipleDeserializable, T>::value>> : std::true_type {};
+        bool operator==(const HashedKey& other) const { return hash == other.hash && value == other.value; }
+        bool operator!=(const HashedKey& other) const { return !(*this == other); }
 
+        Key value;
+        size_t hash;
 
-    class Serializer
+    private:
+        // keys are default constructed for every deserialized element, so hash of empty key is computed once
+        static size_t emptyHash()
+        {
+            static const size_t h = Hash{}(Key{});
+            return h;
+        }
+    };
+
+    template<typename Key, typename Hash = std::hash<Key>>
+    struct PrecomputedHash
     {
-    public:
-        template<typename T, typename Check = void>
-        struct SerializeUnit;
+        size_t operator()(const HashedKey<Key, Hash>& key) const { return key.hash; }
+    };
 
-        template<typename Arg>
-        static BytesCount serializeAll(std::string& buf, Arg* data);
+    template<typename Key, typename T, typename Hash = std::hash<Key>>
+    using PrecomputedHashMap = std::unordered_map<HashedKey<Key, Hash>, T, PrecomputedHash<Key, Hash>>;
 
-        template<typename Arg, typename... Args>
-        static BytesCount serializeAll(std::string& buf, Arg* data, Args... args);
-    };
+    template<typename Key, typename Hash = std::hash<Key>>
+    using PrecomputedHashSet = std::unordered_set<HashedKey<Key, Hash>, PrecomputedHash<Key, Hash>>;
 
     /*
-        End of recursion
+        Unordered container, that is serialized with its bucket count, so on deserialization table is allocated once, with the same size.
+        Elements are written in the same format as std containers.
     */
-    template<typename Arg>
-    BytesCount Serializer::serializeAll(std::string& buf, Arg* data)
+    template<typename Cont>
+    struct HashTableWrapper
     {
-        return Serializer::SerializeUnit<Arg>::serializeUnit(buf, data);
-    }
+        static_assert(IsUndorderedMap<Cont>::value || IsUndorderedMultimap<Cont>::value || IsUnorderedSet<Cont>::value || IsUnorderedMultiset<Cont>::value,
+                      "HashTableWrapper supports only unordered containers");
+        HashTableWrapper()
+            : cont{nullptr} {}
+        HashTableWrapper(Cont* _cont)
+            : cont{_cont} {}
+        Cont* cont;
+    };
+
 
     /*
-        Serializes all arguments passed. Writes as binary data in 'buf'
+        Wraps pair of iterators(or iterator and sentinel) to serialize any range without building a container:
+        C++20 views, coroutine generators, stream iterators, parts of containers...
+        Range is written in the same format as std containers(except std::vector<bool>), so it can be read back into vector, list, etc.
+        Range is iterated only once(so input iterators and unsized ranges work too): count is patched in buffer after elements are written.
+        Copyable iterator is copied, so wrapper can be serialized again. Move-only iterator(std::generator) is advanced in place,
+        such wrapper is consumed by serialization.
     */
-    template<typename Arg, typename... Args>
-    BytesCount Serializer::serializeAll(std::string& buf, Arg* data, Args... args)
+    template<typename Iter, typename Sentinel = Iter>
+    struct RangeWrapper
+    {
+        RangeWrapper(Iter _first, Sentinel _last)
+            : first{std::move(_first)}, last{std::move(_last)} {}
+        Iter first;
+        Sentinel last;
+    };
+
+    template<typename Iter, typename Sentinel>
+    RangeWrapper<Iter, Sentinel> makeRangeWrapper(Iter first, Sentinel last)
     {
-        return Serializer::SerializeUnit<Arg>::serializeUnit(buf, data) + serializeAll(buf, args...);
+        return RangeWrapper<Iter, Sentinel>{std::move(first), std::move(last)};
     }
 
+    template<typename Range>
+    auto makeRangeWrapper(Range& range)
+    {
+        return makeRangeWrapper(std::begin(range), std::end(range));
+    }
 
     /*
-        Serializer for arithmetic types.
+        Serializes values returned by 'generator' until it returns empty std::optional.
+        Written in the same format as std containers.
     */
-    template<typename T>
-    struct Serializer::SerializeUnit<T, std::enable_if_t<std::is_arithmetic<T>::value> >
+    template<typename F>
+    struct GeneratorWrapper
     {
-        SerializeUnit() = default;
-
-        static BytesCount serializeUnit(std::string& buf, T* data)
-        {
-            int initSize = buf.size();
-            buf.resize(buf.size() + sizeof(T));
-            memcpy(&buf[initSize], data, sizeof(T));
-            return sizeof(T);
-        }
+        GeneratorWrapper(F _generator)
+            : generator{std::move(_generator)} {}
+        F generator;
     };
 
+
+    // types whose serialized form is exactly their memory representation, so arrays of them can be copied with one memcpy
+    template<typename T>
+    struct IsTriviallySerializable : std::is_arithmetic<T> {};
+
     /*
-        Serializer for array wrappers.
+        Read-only view of array of arithmetic values, it is written in the same format as ArrayWrapper and std::vector.
+        Deserialized view points straight into the buffer(nothing is copied), so buffer must outlive it and must not be changed.
+        Data in buffer must be aligned for T, otherwise deserializer throws.
+        The same works for std::string_view and, with C++20, for std::span<const T>.
     */
     template<typename T>
-    struct Serializer::SerializeUnit<ArrayWrapper<T>>
+    struct ArrayView
     {
-        SerializeUnit() = default;
-
-        static BytesCount serializeUnit(std::string& buf, ArrayWrapper<T>* data)
-        {
-            if(data->start == nullptr || data->size <= 0) throw SerializerExceptions::InvalidArgs{"serializeUnit<ArrayWrapper>() - invalid arguments passed"};
-            BytesCount written = 0;
-            written += SerializeUnit<ElementsCount>::serializeUnit(buf, &(data->size));
-            for(ElementsCount i = 0; i < data->size; ++i)
-            {
-                written += SerializeUnit<T>::serializeUnit(buf, data->start + i);
-            }
-            return written;
-        }
+        static_assert(IsTriviallySerializable<T>::value, "ArrayView supports only arithmetic types");
+        ArrayView()
+            : start{nullptr}, size{0} {}
+        ArrayView(const T* _start, ElementsCount _size)
+            : start{_start}, size{_size} {}
+        const T* start;
+        ElementsCount size;
     };
 
-    /*
-        Serializer for iterables(they are in most cases can be serialized in the same way).
-    */
     template<typename T>
-    struct Serializer::SerializeUnit<T, std::enable_if_t<IsIterable<T>::value>>
+    struct ContiguousStorage<ArrayView<T>>
     {
-        SerializeUnit() = default;
+        typedef T ValueType;
+        static const T* data(const ArrayView<T>* cont) { return cont->start; }
+        static ElementsCount size(const ArrayView<T>* cont) { return cont->size; }
+    };
 
-        static BytesCount serializeUnit(std::string& buf, T* data)
-        {
-            using ContSize = typename T::size_type;
-            using ValueType = typename T::value_type;
-            BytesCount dataSize = 0;
-            ContSize sz = data->size();
-            // writing size
-            dataSize += SerializeUnit<ContSize>::serializeUnit(buf, &sz);
-            auto iter = data->begin();
-            // writing 'size' parts of data
-            while(iter != data->end())
-            {
-                // container value type can be const, that should not interfere serialization
-                // and several containers(such as std::set) always points to const types
-                typedef std::remove_const_t<ValueType> NonConstValueType;
-                dataSize += SerializeUnit<ValueType>::serializeUnit(buf, const_cast<NonConstValueType*>(&(*iter)));
-                ++iter;
-            }
-            return dataSize;
-        }
+#if __cplusplus >= 202002L
+    template<typename T>
+    struct ContiguousStorage<std::span<T>>
+    {
+        typedef std::remove_const_t<T> ValueType;
+        static const ValueType* data(const std::span<T>* cont) { return cont->data(); }
+        static ElementsCount size(const std::span<T>* cont) { return cont->size(); }
     };
+#endif
+
+    // views are deserialized in place, other containers are filled with copy of data
+    template<typename Cont>
+    struct IsContiguousView : std::false_type {};
 
+    template<typename T>
+    struct IsContiguousView<ArrayView<T>> : std::true_type {};
 
+#if __cplusplus >= 202002L
+    template<typename T>
+    struct IsContiguousView<std::span<const T>> : std::true_type {};
+#endif
 
     /*
-        Serializer for strings.
-        They are, of course, iterable, but it is more efficient to write it in one operation, because data is stores sequentially in memory.
+        Aligned layout for arrays of arithmetic values(std::vector, ArrayWrapper, OwningArrayWrapper, ArrayView, std::span).
+        Array is written as count, 1 byte of padding size, padding, elements. Padding makes offset of elements in buffer multiple of 'Alignment'
+        (alignof(T) if it is 0; 64 can be used to align on cache lines). Alignment can't be more than 256.
+        If buffer is aligned(heap memory, mmapped file) and is read at the same offsets it was written, elements can be read
+        as ArrayView or std::span without copying, even from mmapped file(Deserializer::viewAligned).
     */
-    template<>
-    struct Serializer::SerializeUnit<std::string>
+    template<typename Cont, size_t Alignment = 0>
+    struct AlignedWrapper
     {
-        SerializeUnit() = default;
-
-        static BytesCount serializeUnit(std::string& buf, std::string* data)
-        {
-            using ContSize = typename std::string::size_type;
-            BytesCount dataSize = 0;
-            ContSize sz = data->size();
-            // writing size
-            dataSize += SerializeUnit<ContSize>::serializeUnit(buf, &sz);
-            BytesCount initSize = buf.size();
-            buf.resize(buf.size() + data->size());
-            // writing 'size' characters
-            memcpy(&buf[initSize], &((*data)[0]), data->size());
-            dataSize += data->size();
-            return dataSize;
-        }
+        static_assert(Alignment <= 256 && (Alignment & (Alignment - 1)) == 0, "Alignment must be power of 2 not more than 256");
+        AlignedWrapper()
+            : cont{nullptr} {}
+        AlignedWrapper(Cont* _cont)
+            : cont{_cont} {}
+        Cont* cont;
     };
 
     /*
-        Serializer for user type that inherits IsSerializable
+        Minimal number of bytes that serialized T can take.
+        Used to reject corrupted element counts before allocating memory for them.
     */
+    template<typename T, typename = void>
+    struct MinSerializedSize : std::integral_constant<BytesCount, 0> {};
+
     template<typename T>
-    struct Serializer::SerializeUnit<T, std::enable_if_t<IsSerializable<T>::value>>
-    {
-        SerializeUnit() = default;
+    struct MinSerializedSize<T, std::enable_if_t<std::is_arithmetic<T>::value>> : std::integral_constant<BytesCount, sizeof(T)> {};
 
-        static BytesCount serializeUnit(std::string& buf, T* data)
-        {
-            return data->serialize(buf);
-        }
-    };
+    template<typename T>
+    struct MinSerializedSize<T, std::enable_if_t<IsIterable<T>::value>> : std::integral_constant<BytesCount, sizeof(typename T::size_type)> {};
 
+    template<typename T>
+    struct MinSerializedSize<ArrayWrapper<T>> : std::integral_constant<BytesCount, sizeof(ElementsCount)> {};
+
+    template<typename T>
+    struct MinSerializedSize<ArrayView<T>> : std::integral_constant<BytesCount, sizeof(ElementsCount)> {};
+
+    template<typename T1, typename T2>
+    struct MinSerializedSize<std::pair<T1, T2>> : std::integral_constant<BytesCount, MinSerializedSize<std::remove_const_t<T1>>::value + MinSerializedSize<T2>::value> {};
+
+    template<typename Key, typename Hash>
+    struct MinSerializedSize<HashedKey<Key, Hash>> : std::integral_constant<BytesCount, MinSerializedSize<Key>::value + sizeof(uint64_t)> {};
+
+    // number of bytes that every serialized T takes, or 0 if it depends on value
+    template<typename T, typename = void>
+    struct FixedSerializedSize : std::integral_constant<BytesCount, 0> {};
+
+    template<typename T>
+    struct FixedSerializedSize<T, std::enable_if_t<std::is_arithmetic<T>::value>> : std::integral_constant<BytesCount, sizeof(T)> {};
+
+    template<typename T1, typename T2>
+    struct FixedSerializedSize<std::pair<T1, T2>> : std::integral_constant<BytesCount,
+            FixedSerializedSize<std::remove_const_t<T1>>::value == 0 || FixedSerializedSize<T2>::value == 0 ? 0 :
+            FixedSerializedSize<std::remove_const_t<T1>>::value + FixedSerializedSize<T2>::value> {};
+
+    // writes and reads values that have FixedSerializedSize, without bounds checks
+    template<typename T, typename = void>
+    struct FixedLayout;
+
+    template<typename T>
+    struct FixedLayout<T, std::enable_if_t<std::is_arithmetic<T>::value>>
+    {
+        static inline void store(char* out, const T* data) { memcpy(out, data, sizeof(T)); }
+        static inline void load(const char* in, T* data) { memcpy(data, in, sizeof(T)); }
+    };
+
+    template<typename T1, typename T2>
+    struct FixedLayout<std::pair<T1, T2>>
+    {
+        typedef std::remove_const_t<T1> NonConstT1;
+
+        static inline void store(char* out, const std::pair<T1, T2>* data)
+        {
+            FixedLayout<NonConstT1>::store(out, &data->first);
+            FixedLayout<T2>::store(out + FixedSerializedSize<NonConstT1>::value, &data->second);
+        }
+
+        static inline void load(const char* in, std::pair<T1, T2>* data)
+        {
+            FixedLayout<NonConstT1>::load(in, const_cast<NonConstT1*>(&data->first));
+            FixedLayout<T2>::load(in + FixedSerializedSize<NonConstT1>::value, &data->second);
+        }
+    };
+
+    /*
+        Compile time layout of argument list of serializeAll/deserializeAll.
+        Arguments of fixed size that follow each other are written with one resize and read with one bounds check.
+    */
+    template<typename... Args>
+    struct FixedRuns
+    {
+        static constexpr BytesCount sizes[] = {FixedSerializedSize<Args>::value..., 0};
+
+        // index of the first argument starting from 'begin' that has no fixed size
+        static constexpr size_t runEnd(size_t begin)
+        {
+            while(begin < sizeof...(Args) && sizes[begin] > 0) ++begin;
+            return begin;
+        }
+
+        // bytes taken by arguments [begin, end)
+        static constexpr BytesCount bytes(size_t begin, size_t end)
+        {
+            BytesCount total = 0;
+            for(; begin < end; ++begin) total += sizes[begin];
+            return total;
+        }
+    };
+
+    /*
+        Values whose serialized size can be computed without serializing them: fixed size values, strings, string views,
+        pairs and std containers of such values(but not vector<bool>, it is packed).
+        size() is the number of bytes Serializer writes for value, store() writes the same bytes to raw memory and returns their end.
+        User types and wrappers with own encodings have no DirectLayout.
+    */
+    template<typename T, typename = void>
+    struct DirectLayout;
+
+    template<typename T, typename = void>
+    struct HasDirectLayout : std::false_type {};
+
+    template<typename T>
+    struct HasDirectLayout<T, void_t<decltype(DirectLayout<T>::size(nullptr))>> : std::true_type {};
+
+    template<typename T>
+    struct DirectLayout<T, std::enable_if_t<(FixedSerializedSize<T>::value > 0)>>
+    {
+        static inline BytesCount size(const T*) { return FixedSerializedSize<T>::value; }
+        static inline char* store(char* out, const T* data)
+        {
+            FixedLayout<T>::store(out, data);
+            return out + FixedSerializedSize<T>::value;
+        }
+    };
+
+    template<typename T>
+    struct DirectLayout<T, std::enable_if_t<std::is_same<T, std::string>::value || std::is_same<T, std::string_view>::value>>
+    {
+        static inline BytesCount size(const T* data) { return sizeof(size_t) + data->size(); }
+        static inline char* store(char* out, const T* data)
+        {
+            size_t sz = data->size();
+            memcpy(out, &sz, sizeof(sz));
+            if(sz > 0) memcpy(out + sizeof(sz), data->data(), sz);
+            return out + sizeof(sz) + sz;
+        }
+    };
+
+    template<typename T1, typename T2>
+    struct DirectLayout<std::pair<T1, T2>, std::enable_if_t<FixedSerializedSize<std::pair<T1, T2>>::value == 0 &&
+            HasDirectLayout<std::remove_const_t<T1>>::value && HasDirectLayout<T2>::value>>
+    {
+        typedef std::remove_const_t<T1> NonConstT1;
+
+        static inline BytesCount size(const std::pair<T1, T2>* data) { return DirectLayout<NonConstT1>::size(&data->first) + DirectLayout<T2>::size(&data->second); }
+        static inline char* store(char* out, const std::pair<T1, T2>* data)
+        {
+            out = DirectLayout<NonConstT1>::store(out, &data->first);
+            return DirectLayout<T2>::store(out, &data->second);
+        }
+    };
+
+    template<typename T>
+    struct DirectLayout<T, std::enable_if_t<IsIterable<T>::value && !IsString<T>::value && !std::is_same<T, std::string_view>::value && !IsBoolVector<T>::value && !IsSpan<T>::value &&
+            HasDirectLayout<std::remove_const_t<typename T::value_type>>::value>>
+    {
+        typedef std::remove_const_t<typename T::value_type> ValueType;
+        typedef typename T::size_type ContSize;
+
+        static BytesCount size(const T* data)
+        {
+            if constexpr(FixedSerializedSize<ValueType>::value > 0) return sizeof(ContSize) + data->size() * FixedSerializedSize<ValueType>::value;
+            BytesCount total = sizeof(ContSize);
+            for(auto& value : *data) total += DirectLayout<ValueType>::size(&value);
+            return total;
+        }
+
+        static char* store(char* out, const T* data)
+        {
+            ContSize sz = data->size();
+            memcpy(out, &sz, sizeof(sz));
+            out += sizeof(sz);
+            if constexpr(IsVector<T>::value && IsTriviallySerializable<ValueType>::value)
+            {
+                if(sz > 0) memcpy(out, data->data(), sz * sizeof(ValueType));
+                return out + sz * sizeof(ValueType);
+            }
+            for(auto& value : *data) out = DirectLayout<ValueType>::store(out, &value);
+            return out;
+        }
+    };
+
+
+    /*
+        This class must be inherited if object wants to be serializable and has single serializer;
+    */
+    class Serializable
+    {
+    public:
+        virtual BytesCount serialize(std::string& buf) = 0;
+    };
+
+    /*
+        This class must be inherited if object wants to be deserializable and has single serializer;
+    */
+    class Deserializable
+    {
+        virtual BytesCount deserialize(const std::string& buf, BytesCount offset) = 0;
+    };
+
+    /*
+        This class must be inherited if object wants to be serializable and has multiple serializers;
+        This object should have map of serializers, from which needed serializer will be selected by 'id'.
+    */
+    class MultipleSerializable
+    {
+    public:
+        typedef std::unordered_map<SerializerId, SerializerFunction> SerializersMap;
+
+        inline BytesCount serialize(std::string& buf) { return getCurrentSerializer()(buf); }
+        void registerSerializer(SerializerId _id, const SerializerFunction& f);
+        // throws if not have such Id
+        const SerializerFunction& getCurrentSerializer();
+        inline void setSerializerId(SerializerId _id) { curId = _id; }
+        inline SerializerId getSerializerId() const { return curId; }
+
+
+    private:
+        SerializersMap smap;
+        SerializerId curId;
+    };
+
+    /*
+        This class must be inherited if object wants to be deserializable and has multiple serializers;
+        This object should have map of deserializers, from which needed deserializer will be selected by 'id'.
+    */
+    class MultipleDeserializable
+    {
+    public:
+        typedef std::unordered_map<SerializerId, DeserializerFunction> DeserializersMap;
+
+        inline BytesCount deserialize(const std::string& buf, BytesCount offset) { return getCurrentDeserializer()(buf, offset); }
+        void registerDeserializer(SerializerId _id, const DeserializerFunction& f);
+        // throws if not have such Id
+        const DeserializerFunction& getCurrentDeserializer();
+
+        inline void setDeserializerId(SerializerId _id) { curId = _id; }
+
+        inline SerializerId getDeserializerId() const { return curId; }
+
+    private:
+        DeserializersMap dsmap;
+        SerializerId curId;
+    };
+
+
+    // checks for custorm type
+    template<typename T, typename = void>
+    struct IsSerializable : std::false_type {};
+
+    template<typename T>
+    struct IsSerializable<T, std::enable_if_t<std::is_base_of<Serializable, T>::value>> : std::true_type {};
+
+    template<typename T, typename = void>
+    struct IsDeserializable : std::false_type {};
+
+    template<typename T>
+    struct IsDeserializable<T, std::enable_if_t<std::is_base_of<Deserializable, T>::value>> : std::true_type {};
+
+    template<typename T, typename = void>
+    struct IsMultipleSerializable : std::false_type {};
+
+    template<typename T>
+    struct IsMultipleSerializable<T, std::enable_if_t<std::is_base_of<MultipleSerializable, T>::value>> : std::true_type {};
+
+    template<typename T, typename = void>
+    struct IsMultipleDeserializable : std::false_type {};
+
+    template<typename T>
+    struct IsMultipleDeserializable<T, std::enable_if_t<std::is_base_of<MultipleDeserializable, T>::value>> : std::true_type {};
+
+    /*
+        Polymorphic types.
+        Base class of hierarchy must inherit PolymorphicSerializable. Every derived class inherits RegisteredType with its compact id
+        and is registered once in TypeRegistry of base class(before first deserialization).
+        std::unique_ptr<Base> is written as type id followed by object, deserializer creates object of right type by id.
+        Id 0 is reserved for nullptr.
+    */
+    typedef uint16_t TypeId;
+
+    class PolymorphicSerializable : public Serializable, public Deserializable
+    {
+    public:
+        virtual ~PolymorphicSerializable() = default;
+        virtual TypeId getTypeId() const = 0;
+        virtual BytesCount deserialize(const std::string& buf, BytesCount offset) = 0;
+    };
+
+    template<typename T, typename = void>
+    struct IsPolymorphicSerializable : std::false_type {};
+
+    template<typename T>
+    struct IsPolymorphicSerializable<T, std::enable_if_t<std::is_base_of<PolymorphicSerializable, T>::value>> : std::true_type {};
+
+    /*
+        Maps type ids to factories of 'Base' derived classes.
+        Factories are kept in flat table indexed by id, so ids should be small and dense.
+        Registration is not thread safe, it should be done at startup(for example, from initializer of static variable).
+    */
+    template<typename Base>
+    class TypeRegistry
+    {
+    public:
+        static_assert(IsPolymorphicSerializable<Base>::value, "Base of registry must inherit PolymorphicSerializable");
+        typedef std::unique_ptr<Base> (*Factory)();
+        static constexpr TypeId NullTypeId = 0;
+
+        // throws if id is 0 or is already taken by another type
+        template<typename Derived>
+        static bool registerType()
+        {
+            static_assert(std::is_base_of<Base, Derived>::value, "Registered type must be derived from Base");
+            TypeId id = Derived::typeId;
+            if(id == NullTypeId) throw SerializerExceptions::InvalidArgs{"registerType() - type id 0 is reserved for nullptr"};
+            std::vector<Factory>& table = factories();
+            if(table.size() <= id) table.resize(id + 1, nullptr);
+            if(table[id] != nullptr && table[id] != &createObject<Derived>) throw SerializerExceptions::InvalidArgs{"registerType() - type id " + std::to_string(id) + " is already registered"};
+            table[id] = &createObject<Derived>;
+            return true;
+        }
+
+        template<typename... Derived>
+        static bool registerTypes()
+        {
+            return (registerType<Derived>() && ...);
+        }
+
+        inline static bool isRegistered(TypeId id)
+        {
+            const std::vector<Factory>& table = factories();
+            return id < table.size() && table[id] != nullptr;
+        }
+
+        // throws if type with such id is not registered
+        static std::unique_ptr<Base> create(TypeId id)
+        {
+            const std::vector<Factory>& table = factories();
+            if(id >= table.size() || table[id] == nullptr) throw SerializerExceptions::InvalidType{"create() - unknown type id " + std::to_string(id)};
+            return table[id]();
+        }
+
+    private:
+        template<typename Derived>
+        static std::unique_ptr<Base> createObject()
+        {
+            return std::make_unique<Derived>();
+        }
+
+        static std::vector<Factory>& factories()
+        {
+            static std::vector<Factory> table;
+            return table;
+        }
+    };
+
+    /*
+        Gives 'Derived' compile time type id.
+        Usage: class Click : public RegisteredType<Click, Event, 1> {...};
+    */
+    template<typename Derived, typename Base, TypeId Id>
+    class RegisteredType : public Base
+    {
+    public:
+        static_assert(Id != TypeRegistry<Base>::NullTypeId, "Type id 0 is reserved for nullptr");
+        static constexpr TypeId typeId = Id;
+
+        TypeId getTypeId() const override { return Id; }
+    };
+
+
+    /*
+        Keeps last serialized bytes of user type(Serializable or MultipleSerializable) and writes them again with one memcpy,
+        until object is marked dirty or other serializer id is set. Containers of cached objects use cache of every element.
+        Object must be marked dirty after every change. Versions of members are not tracked: if object has cached members,
+        their markDirty() doesn't drop cache of object, so object must be marked dirty too, otherwise old bytes of member are written.
+        The same unchanged object can be serialized from several threads at once: cached bytes are immutable and replaced atomically.
+        Changing object, marking it dirty or setting serializer id must not happen while it is serialized(as with any other object).
+        Usage: CachedSerializable<User> user; user.modify().age = 30;
+    */
+    template<typename T>
+    class CachedSerializable : public T
+    {
+    public:
+        using T::T;
+
+        BytesCount serialize(std::string& buf)
+        {
+            std::shared_ptr<const Cache> cached = cache.load();
+            if(!isValid(cached.get()))
+            {
+                BytesCount start = buf.size();
+                BytesCount written = T::serialize(buf);
+                SerializerId id = 0;
+                if constexpr(IsMultipleSerializable<T>::value) id = this->getSerializerId();
+                // threads that missed cache at the same time write the same bytes, any of them may stay
+                cache.store(std::shared_ptr<const Cache>(new Cache{std::string(buf, start, written), version, id}));
+                return written;
+            }
+            buf.append(cached->bytes);
+            return cached->bytes.size();
+        }
+
+        // deserialized object is changed, so cache is dropped
+        BytesCount deserialize(const std::string& buf, BytesCount offset)
+        {
+            markDirty();
+            return T::deserialize(buf, offset);
+        }
+
+        inline void markDirty() { ++version; }
+        // marks object dirty and gives access to it
+        inline T& modify() { markDirty(); return *this; }
+        inline uint64_t getVersion() const { return version; }
+
+        inline bool isCached() const
+        {
+            return isValid(cache.load().get());
+        }
+
+    private:
+        struct Cache
+        {
+            std::string bytes;
+            uint64_t version;
+            SerializerId id;
+        };
+
+        // pointer to cache that is loaded and replaced atomically, copied together with object
+        class CacheSlot
+        {
+        public:
+            CacheSlot() = default;
+            CacheSlot(const CacheSlot& other)
+                : ptr{other.load()} {}
+            CacheSlot& operator=(const CacheSlot& other) { store(other.load()); return *this; }
+
+#ifdef __cpp_lib_atomic_shared_ptr
+            inline std::shared_ptr<const Cache> load() const { return ptr.load(std::memory_order_acquire); }
+            inline void store(std::shared_ptr<const Cache> cached) { ptr.store(std::move(cached), std::memory_order_release); }
+
+        private:
+            std::atomic<std::shared_ptr<const Cache>> ptr;
+#else
+            // free functions for shared_ptr are deprecated since C++20, where std::atomic<std::shared_ptr> is used instead
+            inline std::shared_ptr<const Cache> load() const { return std::atomic_load_explicit(&ptr, std::memory_order_acquire); }
+            inline void store(std::shared_ptr<const Cache> cached) { std::atomic_store_explicit(&ptr, std::move(cached), std::memory_order_release); }
+
+        private:
+            std::shared_ptr<const Cache> ptr;
+#endif
+        };
+
+        bool isValid(const Cache* cached) const
+        {
+            if(cached == nullptr || cached->version != version) return false;
+            if constexpr(IsMultipleSerializable<T>::value)
+            {
+                if(cached->id != this->getSerializerId()) return false;
+            }
+            return true;
+        }
+
+        CacheSlot cache;
+        uint64_t version = 0;
+    };
+
+
+
+    /*
+        CRC32C(Castagnoli) checksum.
+        Uses SSE4.2 crc32 instruction if processor supports it(checked once at runtime), otherwise slicing-by-8 tables.
+    */
+    class Crc32c
+    {
+    public:
+        typedef uint32_t Checksum;
+
+        // 'crc' is the checksum of previous data, so checksum can be computed by parts
+        static Checksum compute(const void* data, size_t size, Checksum crc = 0);
+        // always uses tables, the same result as compute()
+        static Checksum computeSoftware(const void* data, size_t size, Checksum crc = 0);
+        static bool isHardwareAccelerated();
+    };
+
+
+    class Serializer
+    {
+    public:
+        template<typename T, typename Check = void>
+        struct SerializeUnit;
+
+        template<typename... Args>
+        static BytesCount serializeAll(std::string& buf, Args*... args);
+
+        template<typename... Args>
+        static BytesCount serializeAllChecked(std::string& buf, Args*... args);
+
+    private:
+        template<size_t Begin, typename... Args>
+        static BytesCount serializeFrom(std::string& buf, const std::tuple<Args*...>& args);
+
+        template<size_t Begin, typename... Args, size_t... I>
+        static BytesCount serializeFixed(std::string& buf, const std::tuple<Args*...>& args, std::index_sequence<I...>);
+    };
+
+    /*
+        Serializes all arguments passed. Writes as binary data in 'buf'
+    */
+    template<typename... Args>
+    BytesCount Serializer::serializeAll(std::string& buf, Args*... args)
+    {
+        return serializeFrom<0>(buf, std::tuple<Args*...>(args...));
+    }
+
+    // run of fixed size arguments is written at once, other arguments one by one
+    template<size_t Begin, typename... Args>
+    BytesCount Serializer::serializeFrom(std::string& buf, const std::tuple<Args*...>& args)
+    {
+        if constexpr(Begin == sizeof...(Args))
+        {
+            return 0;
+        }
+        else
+        {
+            constexpr size_t end = FixedRuns<Args...>::runEnd(Begin);
+            if constexpr(end > Begin)
+            {
+                BytesCount written = serializeFixed<Begin>(buf, args, std::make_index_sequence<end - Begin>{});
+                return written + serializeFrom<end>(buf, args);
+            }
+            else
+            {
+                typedef std::remove_pointer_t<std::tuple_element_t<Begin, std::tuple<Args*...>>> Arg;
+                BytesCount written = SerializeUnit<Arg>::serializeUnit(buf, std::get<Begin>(args));
+                return written + serializeFrom<Begin + 1>(buf, args);
+            }
+        }
+    }
+
+    template<size_t Begin, typename... Args, size_t... I>
+    BytesCount Serializer::serializeFixed(std::string& buf, const std::tuple<Args*...>& args, std::index_sequence<I...>)
+    {
+        typedef FixedRuns<Args...> Runs;
+        constexpr BytesCount size = Runs::bytes(Begin, Begin + sizeof...(I));
+        BytesCount initSize = buf.size();
+        buf.resize(initSize + size);
+        char* out = &buf[initSize];
+        (FixedLayout<std::remove_pointer_t<std::tuple_element_t<Begin + I, std::tuple<Args*...>>>>::store(out + Runs::bytes(Begin, Begin + I), std::get<Begin + I>(args)), ...);
+        return size;
+    }
+
+    /*
+        Serializer for arithmetic types.
+    */
+    template<typename T>
+    struct Serializer::SerializeUnit<T, std::enable_if_t<std::is_arithmetic<T>::value> >
+    {
+        SerializeUnit() = default;
+
+        static BytesCount serializeUnit(std::string& buf, T* data)
+        {
+            int initSize = buf.size();
+            buf.resize(buf.size() + sizeof(T));
+            memcpy(&buf[initSize], data, sizeof(T));
+            return sizeof(T);
+        }
+    };
+
+    /*
+        Same as serializeAll, but data is preceded by its length and CRC32C of length and data,
+        so corruption is detected on deserialization before anything is decoded.
+        Must be read back with Deserializer::deserializeAllChecked.
+    */
+    template<typename... Args>
+    BytesCount Serializer::serializeAllChecked(std::string& buf, Args*... args)
+    {
+        BytesCount start = buf.size();
+        BytesCount header = sizeof(BytesCount) + sizeof(Crc32c::Checksum);
+        buf.resize(start + header);
+        BytesCount written = serializeAll(buf, args...);
+        memcpy(&buf[start], &written, sizeof(written));
+        Crc32c::Checksum crc = Crc32c::compute(&buf[start], sizeof(written));
+        crc = Crc32c::compute(&buf[start + header], written, crc);
+        memcpy(&buf[start + sizeof(written)], &crc, sizeof(crc));
+        return header + written;
+    }
+
+
+    /*
+        Serializer for array wrappers.
+    */
+    template<typename T>
+    struct Serializer::SerializeUnit<ArrayWrapper<T>>
+    {
+        SerializeUnit() = default;
+
+        static BytesCount serializeUnit(std::string& buf, ArrayWrapper<T>* data)
+        {
+            if(data->start == nullptr && data->size > 0) throw SerializerExceptions::InvalidArgs{"serializeUnit<ArrayWrapper>() - invalid arguments passed"};
+            BytesCount written = 0;
+            written += SerializeUnit<ElementsCount>::serializeUnit(buf, &(data->size));
+            if constexpr(IsTriviallySerializable<T>::value)
+            {
+                // whole array in one operation
+                BytesCount initSize = buf.size();
+                buf.resize(initSize + data->size * sizeof(T));
+                memcpy(&buf[initSize], data->start, data->size * sizeof(T));
+                written += data->size * sizeof(T);
+            }
+            else
+            {
+                for(ElementsCount i = 0; i < data->size; ++i)
+                {
+                    written += SerializeUnit<T>::serializeUnit(buf, data->start + i);
+                }
+            }
+            return written;
+        }
+    };
+
+    template<typename T>
+    struct Serializer::SerializeUnit<OwningArrayWrapper<T>> : Serializer::SerializeUnit<ArrayWrapper<T>> {};
+
+    /*
+        Serializer for iterables(they are in most cases can be serialized in the same way).
+        Vectors of arithmetic types are written in one operation.
+    */
+    template<typename T>
+    struct Serializer::SerializeUnit<T, std::enable_if_t<IsIterable<T>::value && !IsBoolVector<T>::value && !IsSpan<T>::value>>
+    {
+        SerializeUnit() = default;
+
+        static BytesCount serializeUnit(std::string& buf, T* data)
+        {
+            using ContSize = typename T::size_type;
+            using ValueType = typename T::value_type;
+            BytesCount dataSize = 0;
+            ContSize sz = data->size();
+            // writing size
+            dataSize += SerializeUnit<ContSize>::serializeUnit(buf, &sz);
+            if constexpr(IsVector<T>::value && IsTriviallySerializable<ValueType>::value)
+            {
+                BytesCount initSize = buf.size();
+                buf.resize(initSize + sz * sizeof(ValueType));
+                if(sz > 0) memcpy(&buf[initSize], data->data(), sz * sizeof(ValueType));
+                return dataSize + sz * sizeof(ValueType);
+            }
+            auto iter = data->begin();
+            // writing 'size' parts of data
+            while(iter != data->end())
+            {
+                // container value type can be const, that should not interfere serialization
+                // and several containers(such as std::set) always points to const types
+                typedef std::remove_const_t<ValueType> NonConstValueType;
+                dataSize += SerializeUnit<ValueType>::serializeUnit(buf, const_cast<NonConstValueType*>(&(*iter)));
+                ++iter;
+            }
+            return dataSize;
+        }
+    };
+
+    /*
+        Packing of std::vector<bool> in bits, 8 per byte, the lowest bit first; unused bits of the last byte are zero.
+        With libstdc++ on little endian machine memory of vector is copied as is,
+        otherwise bits are collected in 64-bit words and every word is written with byte stores.
+    */
+    struct BoolVectorPacking
+    {
+        template<typename T>
+        static void pack(T& data, char* out)
+        {
+            size_t sz = data.size();
+            if(sz == 0) return;
+#ifdef SERIALIZER_HAS_BOOL_VECTOR_WORDS
+            memcpy(out, data.begin()._M_p, (sz + 7) / 8);
+#else
+            auto iter = data.begin();
+            for(size_t i = 0; i < sz; i += 64)
+            {
+                size_t count = std::min<size_t>(64, sz - i);
+                uint64_t word = 0;
+                for(size_t bit = 0; bit < count; ++bit, ++iter) word |= uint64_t(*iter) << bit;
+                for(size_t byte = 0; byte < (count + 7) / 8; ++byte) out[i / 8 + byte] = static_cast<char>(word >> (8 * byte));
+            }
+#endif
+            // vector may keep garbage in bits after its size
+            if(sz % 8) out[(sz - 1) / 8] &= static_cast<char>((1u << (sz % 8)) - 1);
+        }
+
+        // 'data' already has its size
+        template<typename T>
+        static void unpack(const char* in, T& data)
+        {
+            size_t sz = data.size();
+            if(sz == 0) return;
+#ifdef SERIALIZER_HAS_BOOL_VECTOR_WORDS
+            char* words = reinterpret_cast<char*>(data.begin()._M_p);
+            memcpy(words, in, (sz + 7) / 8);
+            if(sz % 8) words[(sz - 1) / 8] &= static_cast<char>((1u << (sz % 8)) - 1);
+#else
+            auto iter = data.begin();
+            for(size_t i = 0; i < sz; i += 64)
+            {
+                size_t count = std::min<size_t>(64, sz - i);
+                uint64_t word = 0;
+                for(size_t byte = 0; byte < (count + 7) / 8; ++byte) word |= uint64_t(static_cast<unsigned char>(in[i / 8 + byte])) << (8 * byte);
+                for(size_t bit = 0; bit < count; ++bit, ++iter) *iter = (word >> bit) & 1;
+            }
+#endif
+        }
+    };
+
+    /*
+        Serializer for std::vector<bool>.
+        Values are packed in bits, 8 per byte.
+    */
+    template<typename T>
+    struct Serializer::SerializeUnit<T, std::enable_if_t<IsBoolVector<T>::value>>
+    {
+        SerializeUnit() = default;
+
+        static BytesCount serializeUnit(std::string& buf, T* data)
+        {
+            using ContSize = typename T::size_type;
+            ContSize sz = data->size();
+            BytesCount dataSize = SerializeUnit<ContSize>::serializeUnit(buf, &sz);
+            BytesCount initSize = buf.size();
+            BytesCount packedSize = (sz + 7) / 8;
+            buf.resize(initSize + packedSize);
+            BoolVectorPacking::pack(*data, &buf[initSize]);
+            return dataSize + packedSize;
+        }
+    };
+
+    /*
+        Serializer for ranges.
+    */
+    template<typename Iter, typename Sentinel>
+    struct Serializer::SerializeUnit<RangeWrapper<Iter, Sentinel>>
+    {
+        SerializeUnit() = default;
+
+        static BytesCount serializeUnit(std::string& buf, RangeWrapper<Iter, Sentinel>* data)
+        {
+            if constexpr(std::is_copy_constructible<Iter>::value)
+            {
+                Iter iter = data->first;
+                return serializeElements(buf, iter, data->last);
+            }
+            else
+            {
+                return serializeElements(buf, data->first, data->last);
+            }
+        }
+
+    private:
+        static BytesCount serializeElements(std::string& buf, Iter& iter, const Sentinel& last)
+        {
+            size_t sz = 0;
+            BytesCount countOffset = buf.size();
+            BytesCount dataSize = SerializeUnit<size_t>::serializeUnit(buf, &sz);
+            for(; iter != last; ++iter, ++sz)
+            {
+                // *iter may return temporary(for example, in transforming views), it lives until the end of this iteration
+                auto&& value = *iter;
+                typedef std::remove_cv_t<std::remove_reference_t<decltype(value)>> ValueType;
+                dataSize += SerializeUnit<ValueType>::serializeUnit(buf, const_cast<ValueType*>(std::addressof(value)));
+            }
+            memcpy(&buf[countOffset], &sz, sizeof(sz));
+            return dataSize;
+        }
+    };
+
+    /*
+        Serializer for generators.
+    */
+    template<typename F>
+    struct Serializer::SerializeUnit<GeneratorWrapper<F>>
+    {
+        SerializeUnit() = default;
+
+        static BytesCount serializeUnit(std::string& buf, GeneratorWrapper<F>* data)
+        {
+            typedef typename std::invoke_result_t<F&>::value_type ValueType;
+            size_t sz = 0;
+            BytesCount countOffset = buf.size();
+            BytesCount dataSize = SerializeUnit<size_t>::serializeUnit(buf, &sz);
+            while(auto value = data->generator())
+            {
+                dataSize += SerializeUnit<ValueType>::serializeUnit(buf, &(*value));
+                ++sz;
+            }
+            memcpy(&buf[countOffset], &sz, sizeof(sz));
+            return dataSize;
+        }
+    };
+
+    /*
+        Serializer for varint wrappers.
+    */
+    template<typename T>
+    struct Serializer::SerializeUnit<VarintWrapper<T>>
+    {
+        SerializeUnit() = default;
+
+        static BytesCount serializeUnit(std::string& buf, VarintWrapper<T>* data)
+        {
+            if(data->cont == nullptr) throw SerializerExceptions::InvalidArgs{"serializeUnit<VarintWrapper>() - invalid arguments passed"};
+            ElementsCount sz = data->cont->size();
+            BytesCount written = SerializeUnit<ElementsCount>::serializeUnit(buf, &sz);
+            BytesCount initSize = buf.size();
+            buf.resize(initSize + sz * VarintCodec::maxBytes<T>());
+            size_t encoded = VarintCodec::encode(data->cont->data(), sz, reinterpret_cast<uint8_t*>(&buf[initSize]));
+            buf.resize(initSize + encoded);
+            return written + encoded;
+        }
+    };
+
+
+    /*
+        Serializer for float series: count, maxError(0 if series is lossless), encoded values.
+    */
+    template<typename Cont>
+    struct Serializer::SerializeUnit<FloatSeriesWrapper<Cont>>
+    {
+        SerializeUnit() = default;
+
+        static BytesCount serializeUnit(std::string& buf, FloatSeriesWrapper<Cont>* data)
+        {
+            typedef ContiguousStorage<Cont> Storage;
+            static_assert(std::is_same<typename Storage::ValueType, float>::value || std::is_same<typename Storage::ValueType, double>::value, "FloatSeriesWrapper supports only float and double");
+            if(data->cont == nullptr) throw SerializerExceptions::InvalidArgs{"serializeUnit<FloatSeriesWrapper>() - invalid arguments passed"};
+            ElementsCount sz = Storage::size(data->cont);
+            const typename Storage::ValueType* values = Storage::data(data->cont);
+            if(values == nullptr && sz > 0) throw SerializerExceptions::InvalidArgs{"serializeUnit<FloatSeriesWrapper>() - invalid arguments passed"};
+            BytesCount written = SerializeUnit<ElementsCount>::serializeUnit(buf, &sz);
+            BytesCount errorOffset = buf.size();
+            double maxError = data->maxError > 0 ? data->maxError : 0;
+            written += SerializeUnit<double>::serializeUnit(buf, &maxError);
+            BytesCount initSize = buf.size();
+            buf.resize(initSize + FloatSeriesCodec::maxBytes<typename Storage::ValueType>(sz));
+            uint8_t* out = reinterpret_cast<uint8_t*>(&buf[initSize]);
+            size_t encoded = FloatSeriesCodec::Malformed;
+            if(maxError > 0)
+            {
+                encoded = FloatSeriesCodec::encodeQuantized(values, sz, maxError, out);
+            }
+            if(encoded == FloatSeriesCodec::Malformed)
+            {
+                maxError = 0;
+                memcpy(&buf[errorOffset], &maxError, sizeof(maxError));
+                encoded = FloatSeriesCodec::encode(values, sz, out);
+            }
+            buf.resize(initSize + encoded);
+            return written + encoded;
+        }
+    };
+
+
+    /*
+        Serializer for aligned arrays.
+    */
+    template<typename Cont, size_t Alignment>
+    struct Serializer::SerializeUnit<AlignedWrapper<Cont, Alignment>>
+    {
+        SerializeUnit() = default;
+
+        static BytesCount serializeUnit(std::string& buf, AlignedWrapper<Cont, Alignment>* data)
+        {
+            typedef ContiguousStorage<Cont> Storage;
+            typedef typename Storage::ValueType T;
+            static_assert(IsTriviallySerializable<T>::value, "AlignedWrapper supports only arithmetic types");
+            constexpr size_t alignment = Alignment ? Alignment : alignof(T);
+            if(data->cont == nullptr) throw SerializerExceptions::InvalidArgs{"serializeUnit<AlignedWrapper>() - invalid arguments passed"};
+            ElementsCount sz = Storage::size(data->cont);
+            const T* values = Storage::data(data->cont);
+            if(values == nullptr && sz > 0) throw SerializerExceptions::InvalidArgs{"serializeUnit<AlignedWrapper>() - invalid arguments passed"};
+            BytesCount written = SerializeUnit<ElementsCount>::serializeUnit(buf, &sz);
+            uint8_t padding = static_cast<uint8_t>((alignment - (buf.size() + sizeof(padding)) % alignment) % alignment);
+            written += SerializeUnit<uint8_t>::serializeUnit(buf, &padding);
+            buf.append(padding, '\0');
+            buf.append(reinterpret_cast<const char*>(values), sz * sizeof(T));
+            return written + padding + sz * sizeof(T);
+        }
+    };
+
+
+    /*
+        Serializer for strings.
+        They are, of course, iterable, but it is more efficient to write it in one operation, because data is stores sequentially in memory.
+    */
+    template<>
+    struct Serializer::SerializeUnit<std::string>
+    {
+        SerializeUnit() = default;
+
+        static BytesCount serializeUnit(std::string& buf, std::string* data)
+        {
+            using ContSize = typename std::string::size_type;
+            BytesCount dataSize = 0;
+            ContSize sz = data->size();
+            // writing size
+            dataSize += SerializeUnit<ContSize>::serializeUnit(buf, &sz);
+            BytesCount initSize = buf.size();
+            buf.resize(buf.size() + data->size());
+            // writing 'size' characters
+            memcpy(&buf[initSize], &((*data)[0]), data->size());
+            dataSize += data->size();
+            return dataSize;
+        }
+    };
+
+    /*
+        Serializers for views, they write the same bytes as std::string and ArrayWrapper.
+    */
+    template<>
+    struct Serializer::SerializeUnit<std::string_view>
+    {
+        SerializeUnit() = default;
+
+        static BytesCount serializeUnit(std::string& buf, std::string_view* data)
+        {
+            size_t sz = data->size();
+            BytesCount written = SerializeUnit<size_t>::serializeUnit(buf, &sz);
+            buf.append(data->data(), sz);
+            return written + sz;
+        }
+    };
+
+    template<typename T>
+    struct Serializer::SerializeUnit<ArrayView<T>>
+    {
+        SerializeUnit() = default;
+
+        static BytesCount serializeUnit(std::string& buf, ArrayView<T>* data)
+        {
+            if(data->start == nullptr && data->size > 0) throw SerializerExceptions::InvalidArgs{"serializeUnit<ArrayView>() - invalid arguments passed"};
+            BytesCount written = SerializeUnit<ElementsCount>::serializeUnit(buf, &data->size);
+            buf.append(reinterpret_cast<const char*>(data->start), data->size * sizeof(T));
+            return written + data->size * sizeof(T);
+        }
+    };
+
+#if __cplusplus >= 202002L
+    template<typename T>
+    struct Serializer::SerializeUnit<std::span<T>>
+    {
+        SerializeUnit() = default;
+
+        static BytesCount serializeUnit(std::string& buf, std::span<T>* data)
+        {
+            typedef std::remove_const_t<T> ValueType;
+            size_t sz = data->size();
+            BytesCount written = SerializeUnit<size_t>::serializeUnit(buf, &sz);
+            if constexpr(IsTriviallySerializable<ValueType>::value)
+            {
+                buf.append(reinterpret_cast<const char*>(data->data()), sz * sizeof(ValueType));
+                return written + sz * sizeof(ValueType);
+            }
+            for(auto& value : *data)
+            {
+                written += SerializeUnit<ValueType>::serializeUnit(buf, const_cast<ValueType*>(&value));
+            }
+            return written;
+        }
+    };
+#endif
+
+    /*
+        Serializer for user type that inherits IsSerializable
+    */
+    template<typename T>
+    struct Serializer::SerializeUnit<T, std::enable_if_t<IsSerializable<T>::value>>
+    {
+        SerializeUnit() = default;
+
+        static BytesCount serializeUnit(std::string& buf, T* data)
+        {
+            return data->serialize(buf);
+        }
+    };
+
+
+    /*
+        Serializer for pointer to polymorphic type: type id, then object
+    */
+    template<typename T>
+    struct Serializer::SerializeUnit<std::unique_ptr<T>, std::enable_if_t<IsPolymorphicSerializable<T>::value>>
+    {
+        SerializeUnit() = default;
+
+        static BytesCount serializeUnit(std::string& buf, std::unique_ptr<T>* data)
+        {
+            TypeId id = *data ? (*data)->getTypeId() : TypeRegistry<T>::NullTypeId;
+            BytesCount written = SerializeUnit<TypeId>::serializeUnit(buf, &id);
+            if(*data) written += (*data)->serialize(buf);
+            return written;
+        }
+    };
+
+
+    /*
+        Serializer for user type that inherits IsMultipleSerializable
+    */
+    template<typename T>
+    struct Serializer::SerializeUnit<T, std::enable_if_t<IsMultipleSerializable<T>::value>>
+    {
+        SerializeUnit() = default;
+
+        static BytesCount serializeUnit(std::string& buf, T* data)
+        {
+            return data->serialize(buf);
+        }
+    };
+
+    /*
+        Serializer for std::pair
+    */
+    template<typename T1, typename T2>
+    struct Serializer::SerializeUnit<std::pair<T1, T2>>
+    {
+        SerializeUnit() = default;
+
+        static BytesCount serializeUnit(std::string& buf, std::pair<T1, T2>* data)
+        {
+            typedef std::remove_const_t<T1> NonConstT1;
+            // throwing away const, because std containers, such as std::unordered_map, use const Key in their value type
+            return serializeAll(buf, const_cast<NonConstT1*>(&data->first), &data->second);
+        }
+    };
+
+
+    /*
+        Key with hash: key, then hash as 64-bit value.
+    */
+    template<typename Key, typename Hash>
+    struct Serializer::SerializeUnit<HashedKey<Key, Hash>>
+    {
+        SerializeUnit() = default;
+
+        static BytesCount serializeUnit(std::string& buf, HashedKey<Key, Hash>* data)
+        {
+            uint64_t hash = data->hash;
+            return serializeAll(buf, &data->value, &hash);
+        }
+    };
+
+    /*
+        Unordered container with bucket count.
+    */
+    template<typename Cont>
+    struct Serializer::SerializeUnit<HashTableWrapper<Cont>>
+    {
+        SerializeUnit() = default;
+
+        static BytesCount serializeUnit(std::string& buf, HashTableWrapper<Cont>* data)
+        {
+            if(data->cont == nullptr) throw SerializerExceptions::InvalidArgs{"serializeUnit<HashTableWrapper>() - invalid arguments passed"};
+            ElementsCount buckets = data->cont->bucket_count();
+            return serializeAll(buf, &buckets, data->cont);
+        }
+    };
+
+
+    /*
+        Output for scatter-gather writes(writev/sendmsg).
+        Small values are written in scratch buffer, large contiguous payloads are referenced in place instead of being copied.
+        Referenced data must stay alive and unchanged until output is written.
+    */
+    class ScatterGatherBuffer
+    {
+    public:
+        struct Segment
+        {
+            const char* data;
+            size_t size;
+        };
+
+        // payloads of 'threshold' bytes and more are referenced
+        explicit ScatterGatherBuffer(size_t _threshold = 4096)
+            : threshold{_threshold} {}
+
+        inline std::string& scratch() { return scratchBuf; }
+        inline size_t getThreshold() const { return threshold; }
+
+        // appends payload to output: copies it to scratch buffer if it is small and references otherwise
+        void append(const void* data, size_t size);
+        // segments in order of output, pointers are valid until next modification
+        std::vector<Segment> segments() const;
+#ifdef SERIALIZER_HAS_IOVEC
+        // ready to pass to writev/sendmsg
+        std::vector<iovec> iovecs() const;
+#endif
+        BytesCount size() const;
+        // all segments copied in one string(the same as Serializer::serializeAll would write)
+        std::string flatten() const;
+        void clear();
+
+    private:
+        // part is either range of scratch buffer(data == nullptr) or referenced payload
+        struct Part
+        {
+            const char* data;
+            size_t offset;
+            size_t size;
+        };
+
+        size_t threshold;
+        std::string scratchBuf;
+        std::vector<Part> parts;
+        // start of scratch part that is not closed by referenced payload yet
+        size_t scratchStart = 0;
+    };
+
+    /*
+        Serializes to ScatterGatherBuffer. Output bytes are the same as the ones of Serializer::serializeAll.
+        Strings and contiguous arrays of arithmetic types(vectors, array wrappers) are referenced if they are large enough,
+        also when they are nested in containers or pairs. Everything else is written by Serializer to scratch buffer.
+    */
+    class ScatterGatherSerializer
+    {
+    public:
+        template<typename T, typename Check = void>
+        struct GatherUnit
+        {
+            static BytesCount gatherUnit(ScatterGatherBuffer& out, T* data)
+            {
+                return Serializer::SerializeUnit<T>::serializeUnit(out.scratch(), data);
+            }
+        };
+
+        template<typename... Args>
+        static BytesCount serializeAll(ScatterGatherBuffer& out, Args... args)
+        {
+            // comma fold is sequenced left to right, so scratch bytes and referenced payloads are appended in order of arguments
+            BytesCount written = 0;
+            ((written += GatherUnit<std::remove_pointer_t<Args>>::gatherUnit(out, args)), ...);
+            return written;
+        }
+    };
+
+    template<>
+    struct ScatterGatherSerializer::GatherUnit<std::string>
+    {
+        static BytesCount gatherUnit(ScatterGatherBuffer& out, std::string* data)
+        {
+            size_t sz = data->size();
+            BytesCount written = Serializer::SerializeUnit<size_t>::serializeUnit(out.scratch(), &sz);
+            out.append(data->data(), sz);
+            return written + sz;
+        }
+    };
+
+    template<>
+    struct ScatterGatherSerializer::GatherUnit<std::string_view>
+    {
+        static BytesCount gatherUnit(ScatterGatherBuffer& out, std::string_view* data)
+        {
+            size_t sz = data->size();
+            BytesCount written = Serializer::SerializeUnit<size_t>::serializeUnit(out.scratch(), &sz);
+            out.append(data->data(), sz);
+            return written + sz;
+        }
+    };
+
+    template<typename T>
+    struct ScatterGatherSerializer::GatherUnit<ArrayView<T>>
+    {
+        static BytesCount gatherUnit(ScatterGatherBuffer& out, ArrayView<T>* data)
+        {
+            if(data->start == nullptr && data->size > 0) throw SerializerExceptions::InvalidArgs{"gatherUnit<ArrayView>() - invalid arguments passed"};
+            BytesCount written = Serializer::SerializeUnit<ElementsCount>::serializeUnit(out.scratch(), &data->size);
+            out.append(data->start, data->size * sizeof(T));
+            return written + data->size * sizeof(T);
+        }
+    };
+
+    template<typename T>
+    struct ScatterGatherSerializer::GatherUnit<ArrayWrapper<T>, std::enable_if_t<IsTriviallySerializable<T>::value>>
+    {
+        static BytesCount gatherUnit(ScatterGatherBuffer& out, ArrayWrapper<T>* data)
+        {
+            if(data->start == nullptr && data->size > 0) throw SerializerExceptions::InvalidArgs{"gatherUnit<ArrayWrapper>() - invalid arguments passed"};
+            BytesCount written = Serializer::SerializeUnit<ElementsCount>::serializeUnit(out.scratch(), &data->size);
+            out.append(data->start, data->size * sizeof(T));
+            return written + data->size * sizeof(T);
+        }
+    };
+
+    template<typename T>
+    struct ScatterGatherSerializer::GatherUnit<T, std::enable_if_t<IsIterable<T>::value && !IsString<T>::value && !IsBoolVector<T>::value && !IsSpan<T>::value>>
+    {
+        static BytesCount gatherUnit(ScatterGatherBuffer& out, T* data)
+        {
+            using ContSize = typename T::size_type;
+            using ValueType = typename T::value_type;
+            ContSize sz = data->size();
+            BytesCount written = Serializer::SerializeUnit<ContSize>::serializeUnit(out.scratch(), &sz);
+            if constexpr(IsVector<T>::value && IsTriviallySerializable<ValueType>::value)
+            {
+                out.append(data->data(), sz * sizeof(ValueType));
+                return written + sz * sizeof(ValueType);
+            }
+            typedef std::remove_const_t<ValueType> NonConstValueType;
+            for(auto& value : *data)
+            {
+                written += GatherUnit<NonConstValueType>::gatherUnit(out, const_cast<NonConstValueType*>(&value));
+            }
+            return written;
+        }
+    };
+
+    template<typename T1, typename T2>
+    struct ScatterGatherSerializer::GatherUnit<std::pair<T1, T2>>
+    {
+        static BytesCount gatherUnit(ScatterGatherBuffer& out, std::pair<T1, T2>* data)
+        {
+            typedef std::remove_const_t<T1> NonConstT1;
+            return serializeAll(out, const_cast<NonConstT1*>(&data->first), &data->second);
+        }
+    };
+
+
+    /*
+        Deserializer works in the same way as serializer,
+        but for custom types inheritance from Deserializable must be done.
+        Every length prefix is checked against the buffer size, so truncated or corrupted buffer leads to OutOfBounds exception instead of reading garbage.
+        Checks can be turned off by defining SERIALIZER_NO_BOUNDS_CHECKS before including this header.
+    */
+    class Deserializer
+    {
+    public:
+
+        template<typename T, typename Check = void>
+        struct DeserializeUnit;
+
+        // throws OutOfBounds if 'count' bytes starting from 'offset' are not in 'buf'
+        static inline void checkBounds(const std::string& buf, BytesCount offset, BytesCount count)
+        {
+            checkBounds(buf.size(), offset, count);
+        }
+
+        // the same for buffer of 'bufSize' bytes, that is not std::string(for example, mmapped file)
+        static inline void checkBounds(BytesCount bufSize, BytesCount offset, BytesCount count)
+        {
+#ifndef SERIALIZER_NO_BOUNDS_CHECKS
+            if(offset > bufSize || count > bufSize - offset) throw SerializerExceptions::OutOfBounds{"deserializeUnit() - buffer is too short"};
+#else
+            (void)bufSize; (void)offset; (void)count;
+#endif
+        }
+
+        // throws OutOfBounds if 'count' elements of 'elementSize' bytes starting from 'offset' are not in 'buf'
+        static inline void checkElements(const std::string& buf, BytesCount offset, ElementsCount count, BytesCount elementSize)
+        {
+            checkElements(buf.size(), offset, count, elementSize);
+        }
+
+        static inline void checkElements(BytesCount bufSize, BytesCount offset, ElementsCount count, BytesCount elementSize)
+        {
+#ifndef SERIALIZER_NO_BOUNDS_CHECKS
+            if(offset > bufSize || (elementSize != 0 && count > (bufSize - offset) / elementSize)) throw SerializerExceptions::OutOfBounds{"deserializeUnit() - buffer is too short"};
+#else
+            (void)bufSize; (void)offset; (void)count; (void)elementSize;
+#endif
+        }
+
+        // returns pointer to 'count' elements of T in 'buf'; throws InvalidArgs if they are not aligned for T
+        template<typename T>
+        static const T* viewElements(const std::string& buf, BytesCount offset, ElementsCount count)
+        {
+            return viewElements<T>(buf.data(), buf.size(), offset, count);
+        }
+
+        template<typename T>
+        static const T* viewElements(const char* data, BytesCount size, BytesCount offset, ElementsCount count)
+        {
+            checkElements(size, offset, count, sizeof(T));
+            const char* start = data + offset;
+            if(reinterpret_cast<uintptr_t>(start) % alignof(T) != 0) throw SerializerExceptions::InvalidArgs{"viewElements() - data in buffer is not aligned"};
+            return reinterpret_cast<const T*>(start);
+        }
+
+        template<typename... Args>
+        static BytesCount deserializeAll(const std::string& buf, BytesCount offset, Args*... args);
+
+        template<typename... Args>
+        static BytesCount deserializeAllChecked(const std::string& buf, BytesCount offset, Args*... args);
+
+        template<typename T, typename F>
+        static BytesCount deserializeEach(const std::string& buf, BytesCount offset, F callback);
+
+        template<typename T, typename OutputIt>
+        static BytesCount deserializeInto(const std::string& buf, BytesCount offset, OutputIt out);
+
+        // reads array written with AlignedWrapper straight from memory(for example, mmapped file) as view; returns bytes read
+        template<typename T>
+        static BytesCount viewAligned(const char* data, BytesCount size, BytesCount offset, ArrayView<T>* view);
+
+        // reads count of aligned array and skips padding; returns offset of elements
+        static inline BytesCount readAlignedHeader(const char* data, BytesCount size, BytesCount offset, ElementsCount* count)
+        {
+            uint8_t padding;
+            checkBounds(size, offset, sizeof(*count) + sizeof(padding));
+            memcpy(count, data + offset, sizeof(*count));
+            memcpy(&padding, data + offset + sizeof(*count), sizeof(padding));
+            return offset + sizeof(*count) + sizeof(padding) + padding;
+        }
+
+    private:
+        template<size_t Begin, typename... Args>
+        static BytesCount deserializeFrom(const std::string& buf, BytesCount offset, const std::tuple<Args*...>& args);
+
+        template<size_t Begin, typename... Args, size_t... I>
+        static BytesCount deserializeFixed(const std::string& buf, BytesCount offset, const std::tuple<Args*...>& args, std::index_sequence<I...>);
+    };
+
+    template<typename... Args>
+    BytesCount Deserializer::deserializeAll(const std::string& buf, BytesCount offset, Args*... args)
+    {
+        return deserializeFrom<0>(buf, offset, std::tuple<Args*...>(args...));
+    }
+
+    // run of fixed size arguments is read after one bounds check, other arguments one by one
+    template<size_t Begin, typename... Args>
+    BytesCount Deserializer::deserializeFrom(const std::string& buf, BytesCount offset, const std::tuple<Args*...>& args)
+    {
+        if constexpr(Begin == sizeof...(Args))
+        {
+            return 0;
+        }
+        else
+        {
+            constexpr size_t end = FixedRuns<Args...>::runEnd(Begin);
+            if constexpr(end > Begin)
+            {
+                BytesCount read = deserializeFixed<Begin>(buf, offset, args, std::make_index_sequence<end - Begin>{});
+                return read + deserializeFrom<end>(buf, offset + read, args);
+            }
+            else
+            {
+                typedef std::remove_pointer_t<std::tuple_element_t<Begin, std::tuple<Args*...>>> Arg;
+                BytesCount read = DeserializeUnit<Arg>::deserializeUnit(buf, offset, std::get<Begin>(args));
+                return read + deserializeFrom<Begin + 1>(buf, offset + read, args);
+            }
+        }
+    }
+
+    template<size_t Begin, typename... Args, size_t... I>
+    BytesCount Deserializer::deserializeFixed(const std::string& buf, BytesCount offset, const std::tuple<Args*...>& args, std::index_sequence<I...>)
+    {
+        typedef FixedRuns<Args...> Runs;
+        constexpr BytesCount size = Runs::bytes(Begin, Begin + sizeof...(I));
+        checkBounds(buf, offset, size);
+        const char* in = buf.data() + offset;
+        (FixedLayout<std::remove_pointer_t<std::tuple_element_t<Begin + I, std::tuple<Args*...>>>>::load(in + Runs::bytes(Begin, Begin + I), std::get<Begin + I>(args)), ...);
+        return size;
+    }
+
+    // for arithmetic
+    template<typename T>
+    struct Deserializer::DeserializeUnit<T, std::enable_if_t<std::is_arithmetic<T>::value> >
+    {
+        static BytesCount deserializeUnit(const std::string& buf, BytesCount offset, T* data)
+        {
+            checkBounds(buf, offset, sizeof(T));
+            memcpy(data, &buf[offset], sizeof(T));
+            return sizeof(T);
+        }
+    };
+
+
+    /*
+        Reads data written by Serializer::serializeAllChecked.
+        Checksum is verified before decoding, so corrupted data(including corrupted length) throws ChecksumMismatch and arguments are left untouched.
+        Throws InvalidArgs if data is intact but arguments read more bytes than were written.
+    */
+    template<typename... Args>
+    BytesCount Deserializer::deserializeAllChecked(const std::string& buf, BytesCount offset, Args*... args)
+    {
+        BytesCount length;
+        Crc32c::Checksum stored;
+        BytesCount header = DeserializeUnit<BytesCount>::deserializeUnit(buf, offset, &length);
+        header += DeserializeUnit<Crc32c::Checksum>::deserializeUnit(buf, offset + header, &stored);
+        // checked even without bounds checks, checksum can't be computed over bytes that are not in the buffer
+        if(offset + header > buf.size() || length > buf.size() - offset - header) throw SerializerExceptions::ChecksumMismatch{"deserializeAllChecked() - length exceeds buffer"};
+        Crc32c::Checksum crc = Crc32c::compute(&buf[offset], sizeof(length));
+        if(Crc32c::compute(&buf[offset + header], length, crc) != stored) throw SerializerExceptions::ChecksumMismatch{"deserializeAllChecked() - checksum mismatch"};
+        BytesCount read = deserializeAll(buf, offset + header, args...);
+        if(read > length) throw SerializerExceptions::InvalidArgs{"deserializeAllChecked() - arguments don't match data"};
+        return header + length;
+    }
+
+    /*
+        Reads serialized container(or range) of T element by element and passes every element to 'callback' without building the container.
+        The same object is reused for all elements, so 'callback' should move or copy it if needs to keep it.
+    */
+    template<typename T, typename F>
+    BytesCount Deserializer::deserializeEach(const std::string& buf, BytesCount offset, F callback)
+    {
+        size_t count;
+        BytesCount internalOffset = offset + DeserializeUnit<size_t>::deserializeUnit(buf, offset, &count);
+        T value;
+        for(size_t i = 0; i < count; ++i)
+        {
+            internalOffset += DeserializeUnit<T>::deserializeUnit(buf, internalOffset, &value);
+            callback(value);
+        }
+        return internalOffset - offset;
+    }
+
+    /*
+        Reads serialized container(or range) of T and writes elements to output iterator.
+    */
+    template<typename T, typename OutputIt>
+    BytesCount Deserializer::deserializeInto(const std::string& buf, BytesCount offset, OutputIt out)
+    {
+        return deserializeEach<T>(buf, offset, [&out](T& value) { *out++ = std::move(value); });
+    }
+
+    template<typename T>
+    BytesCount Deserializer::viewAligned(const char* data, BytesCount size, BytesCount offset, ArrayView<T>* view)
+    {
+        ElementsCount count;
+        BytesCount elementsOffset = readAlignedHeader(data, size, offset, &count);
+        *view = ArrayView<T>(viewElements<T>(data, size, elementsOffset, count), count);
+        return elementsOffset + count * sizeof(T) - offset;
+    }
+
+
+    /*
+        Deserializer for array wrappers.
+        WARNING: before deserialization, array wrapper should have 'start' member set(memory allocated) and 'capacity' large enough.
+        Throws InvalidArgs if serialized array has more elements than 'capacity'.
+    */
+    template<typename T>
+    struct Deserializer::DeserializeUnit<ArrayWrapper<T>>
+    {
+        DeserializeUnit() = default;
+
+        static BytesCount deserializeUnit(const std::string& buf, BytesCount offset, ArrayWrapper<T>* data)
+        {
+            if(data->start == nullptr) throw SerializerExceptions::InvalidArgs{"deserializeUnit<ArrayWrapper>() - invalid arguments passed"};
+            ElementsCount count;
+            BytesCount internalOffset = offset + DeserializeUnit<ElementsCount>::deserializeUnit(buf, offset, &count);
+            if(count > data->capacity) throw SerializerExceptions::InvalidArgs{"deserializeUnit<ArrayWrapper>() - array capacity is too small"};
+            return internalOffset - offset + readElements(buf, internalOffset, count, data);
+        }
+
+        // reads 'count' elements(count is already read) into 'data', which has enough capacity
+        static BytesCount readElements(const std::string& buf, BytesCount offset, ElementsCount count, ArrayWrapper<T>* data)
+        {
+            BytesCount internalOffset = offset;
+            if constexpr(IsTriviallySerializable<T>::value)
+            {
+                checkElements(buf, internalOffset, count, sizeof(T));
+                memcpy(data->start, &buf[internalOffset], count * sizeof(T));
+                internalOffset += count * sizeof(T);
+            }
+            else
+            {
+                // elements may have variable size, so offset is moved by bytes really read
+                for(ElementsCount i = 0; i < count; ++i)
+                {
+                    internalOffset += DeserializeUnit<T>::deserializeUnit(buf, internalOffset, data->start + i);
+                }
+            }
+            data->size = count;
+            return internalOffset - offset;
+        }
+    };
+
+    /*
+        Deserializer for owning array wrappers.
+        Allocates memory if current capacity is not enough.
+    */
+    template<typename T>
+    struct Deserializer::DeserializeUnit<OwningArrayWrapper<T>>
+    {
+        DeserializeUnit() = default;
+
+        static BytesCount deserializeUnit(const std::string& buf, BytesCount offset, OwningArrayWrapper<T>* data)
+        {
+            ElementsCount count;
+            BytesCount internalOffset = offset + DeserializeUnit<ElementsCount>::deserializeUnit(buf, offset, &count);
+            if(count > data->capacity || data->start == nullptr)
+            {
+                // every element takes at least one byte, so corrupted count is rejected before allocation
+                checkElements(buf, internalOffset, count, std::max<BytesCount>(MinSerializedSize<T>::value, 1));
+                data->reallocate(count);
+            }
+            return internalOffset - offset + DeserializeUnit<ArrayWrapper<T>>::readElements(buf, internalOffset, count, data);
+        }
+    };
+
+
+    /*
+        For std containers.
+        Vectors of arithmetic types are read in one operation.
+        Vector, list and deque are resized and their elements are deserialized in place, so memory that elements already own(strings, nested containers) is reused.
+        Decoding into the same container repeatedly does not allocate in steady state.
+        Existing elements of user types are reset to T{} first, so they don't keep members that their deserializer doesn't assign.
+    */
+    template<typename T>
+    struct Deserializer::DeserializeUnit<T, std::enable_if_t<IsIterable<T>::value && !IsBoolVector<T>::value && !IsSpan<T>::value>>
+    {
+        static BytesCount deserializeUnit(const std::string &buf, BytesCount offset, T *data)
+        {
+            using ContSize = typename T::size_type;
+            using DataType = typename DecodedValueType<typename T::value_type>::type;
+            using Adder = ContainerSerializerHelper::ContainerAdder<T>;
+            ContSize contSize;
+            BytesCount internalOffset = offset;
+            internalOffset += DeserializeUnit<ContSize>::deserializeUnit(buf, internalOffset, &contSize);
+            constexpr BytesCount minSize = MinSerializedSize<DataType>::value;
+            if constexpr(IsVector<T>::value && IsTriviallySerializable<DataType>::value)
+            {
+                // whole vector in one operation
+                checkElements(buf, internalOffset, contSize, sizeof(DataType));
+                data->resize(contSize);
+                if(contSize > 0) memcpy(data->data(), &buf[internalOffset], contSize * sizeof(DataType));
+                internalOffset += contSize * sizeof(DataType);
+            }
+            else if constexpr((IsVector<T>::value || IsList<T>::value || IsDeque<T>::value) && minSize > 0)
+            {
+                // corrupted size must not lead to huge allocation
+                checkElements(buf, internalOffset, contSize, minSize);
+                size_t reused = std::min<size_t>(data->size(), contSize);
+                data->resize(contSize);
+                for(auto& dataPiece : *data)
+                {
+                    if constexpr(!IsFullyDeserialized<DataType>::value)
+                    {
+                        // new elements are default constructed already
+                        if(reused > 0)
+                        {
+                            dataPiece = DataType{};
+                            --reused;
+                        }
+                    }
+                    internalOffset += DeserializeUnit<DataType>::deserializeUnit(buf, internalOffset, &dataPiece);
+                }
+            }
+            else
+            {
+                data->clear();
+                if constexpr(minSize > 0)
+                {
+                    checkElements(buf, internalOffset, contSize, minSize);
+                    // reservation is limited by remaining bytes also when bounds checks are off
+                    BytesCount remaining = internalOffset < buf.size() ? buf.size() - internalOffset : 0;
+                    Adder::prepare(data, std::min<ElementsCount>(contSize, remaining / minSize));
+                }
+                for(ContSize i = 0; i < contSize; ++i)
+                {
+                    DataType dataPiece;
+                    internalOffset += DeserializeUnit<DataType>::deserializeUnit(buf, internalOffset, &dataPiece);
+                    Adder::addTo(data, &dataPiece);
+                }
+                Adder::finish(data);
+            }
+            return internalOffset - offset;
+        }
+    };
+
+
+    // for std::vector<bool>
+    template<typename T>
+    struct Deserializer::DeserializeUnit<T, std::enable_if_t<IsBoolVector<T>::value>>
+    {
+        static BytesCount deserializeUnit(const std::string &buf, BytesCount offset, T *data)
+        {
+            using ContSize = typename T::size_type;
+            ContSize contSize;
+            BytesCount internalOffset = offset + DeserializeUnit<ContSize>::deserializeUnit(buf, offset, &contSize);
+            checkElements(buf, internalOffset, contSize / 8 + (contSize % 8 != 0), 1);
+            BytesCount packedSize = (contSize + 7) / 8;
+            data->resize(contSize);
+            BoolVectorPacking::unpack(&buf[internalOffset], *data);
+            return internalOffset + packedSize - offset;
+        }
+    };
+
+
+    // for varint wrappers
+    template<typename T>
+    struct Deserializer::DeserializeUnit<VarintWrapper<T>>
+    {
+        static BytesCount deserializeUnit(const std::string &buf, BytesCount offset, VarintWrapper<T> *data)
+        {
+            if(data->cont == nullptr) throw SerializerExceptions::InvalidArgs{"deserializeUnit<VarintWrapper>() - invalid arguments passed"};
+            ElementsCount count;
+            BytesCount internalOffset = offset + DeserializeUnit<ElementsCount>::deserializeUnit(buf, offset, &count);
+            // every value takes at least one byte
+            checkElements(buf, internalOffset, count, 1);
+            data->cont->resize(count);
+            size_t read = VarintCodec::decode(reinterpret_cast<const uint8_t*>(buf.data()) + internalOffset, buf.size() - internalOffset, data->cont->data(), count);
+            if(read == VarintCodec::Malformed) throw SerializerExceptions::OutOfBounds{"deserializeUnit<VarintWrapper>() - malformed varint"};
+            return internalOffset + read - offset;
+        }
+    };
+
+
+    // for float series
+    template<typename Cont>
+    struct Deserializer::DeserializeUnit<FloatSeriesWrapper<Cont>>
+    {
+        static BytesCount deserializeUnit(const std::string &buf, BytesCount offset, FloatSeriesWrapper<Cont> *data)
+        {
+            if(data->cont == nullptr) throw SerializerExceptions::InvalidArgs{"deserializeUnit<FloatSeriesWrapper>() - invalid arguments passed"};
+            ElementsCount count;
+            double maxError;
+            BytesCount internalOffset = offset + DeserializeUnit<ElementsCount>::deserializeUnit(buf, offset, &count);
+            internalOffset += DeserializeUnit<double>::deserializeUnit(buf, internalOffset, &maxError);
+            if(!(maxError >= 0) || maxError == std::numeric_limits<double>::infinity()) throw SerializerExceptions::OutOfBounds{"deserializeUnit<FloatSeriesWrapper>() - malformed series"};
+            // every value takes at least one bit
+            checkElements(buf, internalOffset, count / 8, 1);
+            auto* values = ContiguousStorage<Cont>::prepare(data->cont, count);
+            const uint8_t* in = reinterpret_cast<const uint8_t*>(buf.data()) + internalOffset;
+            size_t avail = buf.size() - internalOffset;
+            size_t read = maxError > 0 ? FloatSeriesCodec::decodeQuantized(in, avail, maxError, values, count) : FloatSeriesCodec::decode(in, avail, values, count);
+            if(read == FloatSeriesCodec::Malformed) throw SerializerExceptions::OutOfBounds{"deserializeUnit<FloatSeriesWrapper>() - malformed series"};
+            return internalOffset + read - offset;
+        }
+    };
+
+
+    // for aligned arrays, views point into 'buf'
+    template<typename Cont, size_t Alignment>
+    struct Deserializer::DeserializeUnit<AlignedWrapper<Cont, Alignment>>
+    {
+        static BytesCount deserializeUnit(const std::string &buf, BytesCount offset, AlignedWrapper<Cont, Alignment> *data)
+        {
+            typedef typename ContiguousStorage<Cont>::ValueType T;
+            if(data->cont == nullptr) throw SerializerExceptions::InvalidArgs{"deserializeUnit<AlignedWrapper>() - invalid arguments passed"};
+            ElementsCount count;
+            BytesCount elementsOffset = readAlignedHeader(buf.data(), buf.size(), offset, &count);
+            if constexpr(IsContiguousView<Cont>::value)
+            {
+                *data->cont = Cont(viewElements<T>(buf, elementsOffset, count), count);
+            }
+            else
+            {
+                checkElements(buf, elementsOffset, count, sizeof(T));
+                T* values = ContiguousStorage<Cont>::prepare(data->cont, count);
+                if(count > 0) memcpy(values, &buf[elementsOffset], count * sizeof(T));
+            }
+            return elementsOffset + count * sizeof(T) - offset;
+        }
+    };
+
+
+    // for std::string
+    template<>
+    struct Deserializer::DeserializeUnit<std::string>
+    {
+        DeserializeUnit() = default;
+
+        static BytesCount deserializeUnit(const std::string& buf, BytesCount offset, std::string* data)
+        {
+            data->clear();
+            using ContSize = typename std::string::size_type;
+            ContSize contSize;
+            BytesCount internalOffset = offset;
+            internalOffset += DeserializeUnit<ContSize>::deserializeUnit(buf, internalOffset, &contSize);
+            checkBounds(buf, internalOffset, contSize);
+            data->resize(contSize);
+            memcpy(&((*data)[0]), &buf[internalOffset], contSize);
+            internalOffset += contSize;
+            return internalOffset - offset;
+        }
+    };
+
+
+    // for views, they point into 'buf'
+    template<>
+    struct Deserializer::DeserializeUnit<std::string_view>
+    {
+        DeserializeUnit() = default;
+
+        static BytesCount deserializeUnit(const std::string& buf, BytesCount offset, std::string_view* data)
+        {
+            size_t size;
+            BytesCount internalOffset = offset + DeserializeUnit<size_t>::deserializeUnit(buf, offset, &size);
+            checkBounds(buf, internalOffset, size);
+            *data = std::string_view(buf.data() + internalOffset, size);
+            return internalOffset + size - offset;
+        }
+    };
+
+    template<typename T>
+    struct Deserializer::DeserializeUnit<ArrayView<T>>
+    {
+        DeserializeUnit() = default;
+
+        static BytesCount deserializeUnit(const std::string& buf, BytesCount offset, ArrayView<T>* data)
+        {
+            ElementsCount size;
+            BytesCount internalOffset = offset + DeserializeUnit<ElementsCount>::deserializeUnit(buf, offset, &size);
+            *data = ArrayView<T>(viewElements<T>(buf, internalOffset, size), size);
+            return internalOffset + size * sizeof(T) - offset;
+        }
+    };
+
+#if __cplusplus >= 202002L
+    template<typename T>
+    struct Deserializer::DeserializeUnit<std::span<const T>>
+    {
+        static_assert(IsTriviallySerializable<T>::value, "std::span can be deserialized only for arithmetic types");
+        DeserializeUnit() = default;
+
+        static BytesCount deserializeUnit(const std::string& buf, BytesCount offset, std::span<const T>* data)
+        {
+            size_t size;
+            BytesCount internalOffset = offset + DeserializeUnit<size_t>::deserializeUnit(buf, offset, &size);
+            *data = std::span<const T>(viewElements<T>(buf, internalOffset, size), size);
+            return internalOffset + size * sizeof(T) - offset;
+        }
+    };
+#endif
+
+
+    // for user type
+    template<typename T>
+    struct Deserializer::DeserializeUnit<T, std::enable_if_t<IsDeserializable<T>::value>>
+    {
+        DeserializeUnit() = default;
+
+        static BytesCount deserializeUnit(const std::string& buf, BytesCount offset, T* data)
+        {
+            return data->deserialize(buf, offset);
+        }
+    };
+
+
+    // for pointer to polymorphic type, object is created by TypeRegistry<T>
+    template<typename T>
+    struct Deserializer::DeserializeUnit<std::unique_ptr<T>, std::enable_if_t<IsPolymorphicSerializable<T>::value>>
+    {
+        DeserializeUnit() = default;
+
+        static BytesCount deserializeUnit(const std::string& buf, BytesCount offset, std::unique_ptr<T>* data)
+        {
+            TypeId id;
+            BytesCount read = DeserializeUnit<TypeId>::deserializeUnit(buf, offset, &id);
+            if(id == TypeRegistry<T>::NullTypeId)
+            {
+                data->reset();
+                return read;
+            }
+            // reusing existing object if it already has right type
+            if(!*data || (*data)->getTypeId() != id) *data = TypeRegistry<T>::create(id);
+            return read + (*data)->deserialize(buf, offset + read);
+        }
+    };
+
+
+    // for user type with multiple serializators
+    template<typename T>
+    struct Deserializer::DeserializeUnit<T, std::enable_if_t<IsMultipleDeserializable<T>::value>>
+    {
+        DeserializeUnit() = default;
+
+        static BytesCount deserializeUnit(const std::string& buf, BytesCount offset, T* data)
+        {
+            return data->deserialize(buf, offset);
+        }
+    };
+
+
+    /*
+        std::pair
+    */
+    template<typename T1, typename T2>
+    struct Deserializer::DeserializeUnit<std::pair<T1, T2>>
+    {
+        DeserializeUnit() = default;
+
+        static BytesCount deserializeUnit(const std::string& buf, BytesCount offset, std::pair<T1, T2>* data)
+        {
+            typedef std::remove_const_t<T1> NonConstT1;
+            // throwing away const, because std containers, such as std::unordered_map, use const Key in their value type
+            return deserializeAll(buf, offset, const_cast<NonConstT1*>(&data->first), &data->second);
+        }
+    };
+
+
+    // for key with hash, stored hash is trusted
+    template<typename Key, typename Hash>
+    struct Deserializer::DeserializeUnit<HashedKey<Key, Hash>>
+    {
+        DeserializeUnit() = default;
+
+        static BytesCount deserializeUnit(const std::string& buf, BytesCount offset, HashedKey<Key, Hash>* data)
+        {
+            uint64_t hash;
+            BytesCount read = deserializeAll(buf, offset, &data->value, &hash);
+            data->hash = static_cast<size_t>(hash);
+            return read;
+        }
+    };
+
+
+    // for unordered container with bucket count
+    template<typename Cont>
+    struct Deserializer::DeserializeUnit<HashTableWrapper<Cont>>
+    {
+        DeserializeUnit() = default;
+
+        static BytesCount deserializeUnit(const std::string& buf, BytesCount offset, HashTableWrapper<Cont>* data)
+        {
+            typedef typename Cont::size_type ContSize;
+            if(data->cont == nullptr) throw SerializerExceptions::InvalidArgs{"deserializeUnit<HashTableWrapper>() - invalid arguments passed"};
+            ElementsCount buckets;
+            ContSize count;
+            BytesCount internalOffset = offset + DeserializeUnit<ElementsCount>::deserializeUnit(buf, offset, &buckets);
+            // count is read again by container deserializer
+            DeserializeUnit<ContSize>::deserializeUnit(buf, internalOffset, &count);
+            checkElements(buf, internalOffset + sizeof(ContSize), count, std::max<BytesCount>(MinSerializedSize<typename DecodedValueType<typename Cont::value_type>::type>::value, 1));
+            // corrupted bucket count must not allocate more than table needs for this count
+            ElementsCount maxBuckets = static_cast<ElementsCount>(count / data->cont->max_load_factor()) * 2 + 16;
+            data->cont->clear();
+            data->cont->rehash(std::min(buckets, maxBuckets));
+            return internalOffset - offset + DeserializeUnit<Cont>::deserializeUnit(buf, internalOffset, data->cont);
+        }
+    };
+
+
+    /*
+        Result of scanning serialized data.
+        Heap estimate assumes libstdc++-like layout of std containers: list and tree nodes have 2 and 4 pointers of overhead,
+        hash nodes have next pointer and cached hash and hash table has one bucket per element.
+    */
+    struct ScanResult
+    {
+        // bytes that deserializeAll would read
+        BytesCount bytes = 0;
+        // elements in all containers and arrays(characters of strings are not counted)
+        ElementsCount elements = 0;
+        // estimated heap memory and number of allocations that decoding into empty objects would need
+        BytesCount heapBytes = 0;
+        ElementsCount allocations = 0;
+    };
+
+    /*
+        Walks serialized data without constructing anything and checks that it can be deserialized as given types.
+        Arrays of fixed size elements are skipped in one step, so scanning is much faster than decoding.
+        Checks are done even with SERIALIZER_NO_BOUNDS_CHECKS, malformed data throws OutOfBounds.
+        User types are not scanned automatically, their layout is given with ScanLayout:
+            template<> struct Serialization::Scanner::ScanUnit<User> : Serialization::Scanner::ScanLayout<std::string, int> {};
+    */
+    class Scanner
+    {
+    public:
+
+        template<typename T, typename Check = void>
+        struct ScanUnit;
+
+        // fields of user type in order they are serialized
+        template<typename... Ts>
+        struct ScanLayout
+        {
+            static BytesCount scanUnit(std::string_view buf, BytesCount offset, ScanResult& result)
+            {
+                BytesCount internalOffset = offset;
+                ((internalOffset += ScanUnit<Ts>::scanUnit(buf, internalOffset, result)), ...);
+                return internalOffset - offset;
+            }
+        };
+
+        template<typename... Ts>
+        static ScanResult scan(std::string_view buf, BytesCount offset = 0)
+        {
+            ScanResult result;
+            result.bytes = ScanLayout<Ts...>::scanUnit(buf, offset, result);
+            return result;
+        }
+
+        static inline void require(std::string_view buf, BytesCount offset, ElementsCount count, BytesCount elementSize)
+        {
+            if(offset > buf.size() || (elementSize != 0 && count > (buf.size() - offset) / elementSize)) throw SerializerExceptions::OutOfBounds{"scanUnit() - buffer is too short"};
+        }
+
+        template<typename T>
+        static T readValue(std::string_view buf, BytesCount offset)
+        {
+            T value;
+            require(buf, offset, 1, sizeof(T));
+            memcpy(&value, buf.data() + offset, sizeof(T));
+            return value;
+        }
+
+        // scans 'count' serialized elements of T
+        template<typename T>
+        static BytesCount scanElements(std::string_view buf, BytesCount offset, ElementsCount count, ScanResult& result)
+        {
+            constexpr BytesCount fixedSize = FixedSerializedSize<T>::value;
+            if constexpr(fixedSize > 0)
+            {
+                require(buf, offset, count, fixedSize);
+                return count * fixedSize;
+            }
+            else
+            {
+                require(buf, offset, count, MinSerializedSize<T>::value);
+                BytesCount internalOffset = offset;
+                for(ElementsCount i = 0; i < count; ++i)
+                {
+                    internalOffset += ScanUnit<T>::scanUnit(buf, internalOffset, result);
+                }
+                return internalOffset - offset;
+            }
+        }
+
+        // adds memory that container of 'count' elements allocates
+        template<typename T>
+        static void addContainer(ScanResult& result, ElementsCount count)
+        {
+            constexpr BytesCount valueSize = sizeof(typename T::value_type);
+            result.elements += count;
+            if(count == 0) return;
+            if constexpr(IsList<T>::value)
+            {
+                result.heapBytes += count * (valueSize + 2 * sizeof(void*));
+                result.allocations += count;
+            }
+            else if constexpr(IsMap<T>::value || IsMultimap<T>::value || IsSet<T>::value || IsMultiset<T>::value)
+            {
+                result.heapBytes += count * (valueSize + 4 * sizeof(void*));
+                result.allocations += count;
+            }
+            else if constexpr(IsUndorderedMap<T>::value || IsUndorderedMultimap<T>::value || IsUnorderedSet<T>::value || IsUnorderedMultiset<T>::value)
+            {
+                result.heapBytes += count * (valueSize + sizeof(void*) + sizeof(size_t)) + count * sizeof(void*);
+                result.allocations += count + 1;
+            }
+            else if constexpr(IsDeque<T>::value)
+            {
+                // deque allocates blocks of 512 bytes and array of pointers to them
+                constexpr ElementsCount blockElements = valueSize < 512 ? 512 / valueSize : 1;
+                ElementsCount blocks = (count + blockElements - 1) / blockElements;
+                result.heapBytes += blocks * blockElements * valueSize + (blocks + 2) * sizeof(void*);
+                result.allocations += blocks + 1;
+            }
+            else
+            {
+                result.heapBytes += count * valueSize;
+                result.allocations += 1;
+            }
+        }
+    };
 
-    /*
-        Serializer for user type that inherits IsMultipleSerializable
-    */
+    // for arithmetic
     template<typename T>
-    struct Serializer::SerializeUnit<T, std::enable_if_t<IsMultipleSerializable<T>::value>>
+    struct Scanner::ScanUnit<T, std::enable_if_t<std::is_arithmetic<T>::value>>
     {
-        SerializeUnit() = default;
-
-        static BytesCount serializeUnit(std::string& buf, T* data)
+        static BytesCount scanUnit(std::string_view buf, BytesCount offset, ScanResult&)
         {
-            return data->serialize(buf);
+            require(buf, offset, 1, sizeof(T));
+            return sizeof(T);
         }
     };
 
-    /*
-        Serializer for std::pair
-    */
-    template<typename T1, typename T2>
-    struct Serializer::SerializeUnit<std::pair<T1, T2>>
+
+    // for std containers
+    template<typename T>
+    struct Scanner::ScanUnit<T, std::enable_if_t<IsIterable<T>::value && !IsString<T>::value && !IsBoolVector<T>::value && !IsSpan<T>::value>>
     {
-        SerializeUnit() = default;
+        static BytesCount scanUnit(std::string_view buf, BytesCount offset, ScanResult& result)
+        {
+            using ContSize = typename T::size_type;
+            ContSize contSize = readValue<ContSize>(buf, offset);
+            BytesCount read = scanElements<typename DecodedValueType<typename T::value_type>::type>(buf, offset + sizeof(ContSize), contSize, result);
+            addContainer<T>(result, contSize);
+            return sizeof(ContSize) + read;
+        }
+    };
 
-        static BytesCount serializeUnit(std::string& buf, std::pair<T1, T2>* data)
+
+    // for std::vector<bool>
+    template<typename T>
+    struct Scanner::ScanUnit<T, std::enable_if_t<IsBoolVector<T>::value>>
+    {
+        static BytesCount scanUnit(std::string_view buf, BytesCount offset, ScanResult& result)
         {
-            typedef std::remove_const_t<T1> NonConstT1;
-            // throwing away const, because std containers, such as std::unordered_map, use const Key in their value type
-            return serializeAll(buf, const_cast<NonConstT1*>(&data->first), &data->second);
+            using ContSize = typename T::size_type;
+            ContSize contSize = readValue<ContSize>(buf, offset);
+            BytesCount packedSize = contSize / 8 + (contSize % 8 != 0);
+            require(buf, offset + sizeof(ContSize), packedSize, 1);
+            result.elements += contSize;
+            if(contSize > 0)
+            {
+                result.heapBytes += (contSize + 63) / 64 * sizeof(uint64_t);
+                result.allocations += 1;
+            }
+            return sizeof(ContSize) + packedSize;
         }
     };
 
 
-    /*
-        Deserializer works in the same way as serializer,
-        but for custom types inheritance from Deserializable must be done.
-    */
-    class Deserializer
+    // for std::string and std::string_view, short strings don't allocate
+    template<>
+    struct Scanner::ScanUnit<std::string>
     {
-    public:
+        static BytesCount scanUnit(std::string_view buf, BytesCount offset, ScanResult& result)
+        {
+            using ContSize = typename std::string::size_type;
+            ContSize contSize = readValue<ContSize>(buf, offset);
+            require(buf, offset + sizeof(ContSize), contSize, 1);
+            if(contSize > std::string().capacity())
+            {
+                result.heapBytes += contSize + 1;
+                result.allocations += 1;
+            }
+            return sizeof(ContSize) + contSize;
+        }
+    };
+
+    template<>
+    struct Scanner::ScanUnit<std::string_view>
+    {
+        static BytesCount scanUnit(std::string_view buf, BytesCount offset, ScanResult&)
+        {
+            using ContSize = typename std::string::size_type;
+            ContSize contSize = readValue<ContSize>(buf, offset);
+            require(buf, offset + sizeof(ContSize), contSize, 1);
+            return sizeof(ContSize) + contSize;
+        }
+    };
 
-        template<typename T, typename Check = void>
-        struct DeserializeUnit;
 
-        template<typename Arg>
-        static BytesCount deserializeAll(const std::string& buf, BytesCount offset, Arg* data);
+    // for arrays, elements are written to caller's memory
+    template<typename T>
+    struct Scanner::ScanUnit<ArrayWrapper<T>>
+    {
+        static BytesCount scanUnit(std::string_view buf, BytesCount offset, ScanResult& result)
+        {
+            ElementsCount count = readValue<ElementsCount>(buf, offset);
+            BytesCount read = scanElements<T>(buf, offset + sizeof(count), count, result);
+            result.elements += count;
+            return sizeof(count) + read;
+        }
+    };
 
-        template<typename Arg, typename... Args>
-        static BytesCount deserializeAll(const std::string& buf, BytesCount offset, Arg* data, Args... args);
+    template<typename T>
+    struct Scanner::ScanUnit<OwningArrayWrapper<T>>
+    {
+        static BytesCount scanUnit(std::string_view buf, BytesCount offset, ScanResult& result)
+        {
+            ElementsCount count = readValue<ElementsCount>(buf, offset);
+            BytesCount read = scanElements<T>(buf, offset + sizeof(count), count, result);
+            addContainer<std::vector<T>>(result, count);
+            return sizeof(count) + read;
+        }
     };
 
-    template<typename Arg>
-    BytesCount Deserializer::deserializeAll(const std::string& buf, BytesCount offset, Arg* data)
+
+    // for views, they point into buffer
+    template<typename T>
+    struct Scanner::ScanUnit<ArrayView<T>>
     {
-        return Deserializer::DeserializeUnit<Arg>::deserializeUnit(buf, offset, data);
-    }
+        static_assert(IsTriviallySerializable<T>::value, "ArrayView supports only arithmetic types");
+        static BytesCount scanUnit(std::string_view buf, BytesCount offset, ScanResult& result)
+        {
+            ElementsCount count = readValue<ElementsCount>(buf, offset);
+            require(buf, offset + sizeof(count), count, sizeof(T));
+            result.elements += count;
+            return sizeof(count) + count * sizeof(T);
+        }
+    };
 
-    template<typename Arg, typename... Args>
-    BytesCount Deserializer::deserializeAll(const std::string& buf, BytesCount offset, Arg* data, Args... args)
+#if __cplusplus >= 202002L
+    template<typename T>
+    struct Scanner::ScanUnit<std::span<const T>> : Scanner::ScanUnit<ArrayView<T>>
     {
-        BytesCount nextOffset = Deserializer::DeserializeUnit<Arg>::deserializeUnit(buf, offset, data);
-        return nextOffset + deserializeAll(buf, offset + nextOffset, args...);
-    }
+        static_assert(IsTriviallySerializable<T>::value, "std::span can be scanned only for arithmetic types");
+    };
+#endif
 
 
-    // for arithmetic
+    // for varint wrappers, every varint is checked as decoder does it
     template<typename T>
-    struct Deserializer::DeserializeUnit<T, std::enable_if_t<std::is_arithmetic<T>::value> >
+    struct Scanner::ScanUnit<VarintWrapper<T>>
     {
-        static BytesCount deserializeUnit(const std::string& buf, BytesCount offset, T* data)
+        static BytesCount scanUnit(std::string_view buf, BytesCount offset, ScanResult& result)
         {
-            memcpy(data, &buf[offset], sizeof(T));
-            return sizeof(T);
+            ElementsCount count = readValue<ElementsCount>(buf, offset);
+            BytesCount internalOffset = offset + sizeof(count);
+            require(buf, internalOffset, count, 1);
+            size_t read = VarintCodec::skip<T>(reinterpret_cast<const uint8_t*>(buf.data()) + internalOffset, buf.size() - internalOffset, count);
+            if(read == VarintCodec::Malformed) throw SerializerExceptions::OutOfBounds{"scanUnit<VarintWrapper>() - malformed varint"};
+            addContainer<std::vector<T>>(result, count);
+            return sizeof(count) + read;
+        }
+    };
+
+
+    // for aligned arrays
+    template<typename Cont, size_t Alignment>
+    struct Scanner::ScanUnit<AlignedWrapper<Cont, Alignment>>
+    {
+        static BytesCount scanUnit(std::string_view buf, BytesCount offset, ScanResult& result)
+        {
+            typedef typename ContiguousStorage<Cont>::ValueType T;
+            ElementsCount count = readValue<ElementsCount>(buf, offset);
+            uint8_t padding = readValue<uint8_t>(buf, offset + sizeof(count));
+            BytesCount elementsOffset = offset + sizeof(count) + sizeof(padding) + padding;
+            require(buf, elementsOffset, count, sizeof(T));
+            if constexpr(IsContiguousView<Cont>::value || std::is_same<Cont, ArrayWrapper<T>>::value) result.elements += count;
+            else addContainer<std::vector<T>>(result, count);
+            return elementsOffset + count * sizeof(T) - offset;
         }
     };
 
 
     /*
-        Deserializer for array wrappers.
-        WARNING: before deserialization, array wrapper should have 'start' member set(memory allocated).
+        std::pair
     */
-    template<typename T>
-    struct Deserializer::DeserializeUnit<ArrayWrapper<T>>
-    {
-        DeserializeUnit() = default;
+    template<typename T1, typename T2>
+    struct Scanner::ScanUnit<std::pair<T1, T2>> : Scanner::ScanLayout<std::remove_const_t<T1>, T2> {};
 
-        static BytesCount deserializeUnit(const std::string& buf, BytesCount offset, ArrayWrapper<T>* data)
+
+    // for key with hash
+    template<typename Key, typename Hash>
+    struct Scanner::ScanUnit<HashedKey<Key, Hash>> : Scanner::ScanLayout<Key, uint64_t> {};
+
+
+    // for unordered container with bucket count
+    template<typename Cont>
+    struct Scanner::ScanUnit<HashTableWrapper<Cont>> : Scanner::ScanLayout<ElementsCount, Cont> {};
+
+
+    /*
+        Keeps buffers between serializations, so messages of the same shape don't allocate memory every time.
+        Buffer is reserved for the biggest message serialized with this context(high-water mark).
+        Buffers taken out with 'takeBuffer' can be given back with 'recycle' after they were sent or written.
+        Context is not thread-safe, 'threadLocal()' gives separate instance for every thread.
+    */
+    class SerializationContext
+    {
+    public:
+        // returns empty buffer with capacity of at least high-water mark
+        std::string& buffer();
+
+        /*
+            Serializes all arguments in context buffer. Returned reference is valid until next call.
+        */
+        template<typename... Args>
+        const std::string& serialize(Args... args)
         {
-            if(data->start == nullptr) throw SerializerExceptions::InvalidArgs{"serializeUnit<ArrayWrapper>() - invalid arguments passed"};
-            BytesCount read = 0;
-            BytesCount internalOffset = offset;
-            read += DeserializeUnit<ElementsCount>::deserializeUnit(buf, internalOffset, &(data->size));
-            internalOffset += sizeof(ElementsCount);
-            for(ElementsCount i = 0; i < data->size; ++i)
-            {
-                read += DeserializeUnit<T>::deserializeUnit(buf, internalOffset, data->start + i);
-                internalOffset += sizeof(T);
-            }
-            return read;
+            std::string& buf = buffer();
+            Serializer::serializeAll(buf, args...);
+            highWaterMark = std::max<BytesCount>(highWaterMark, buf.size());
+            return buf;
         }
+
+        // moves current buffer out of context(for example, to pass it to another thread)
+        std::string takeBuffer();
+        // gives buffer back to context to be reused
+        void recycle(std::string&& buf);
+
+        inline BytesCount getHighWaterMark() const { return highWaterMark; }
+
+        static SerializationContext& threadLocal();
+
+    private:
+        static constexpr size_t MaxSpareBuffers = 8;
+        std::string current;
+        std::vector<std::string> spare;
+        BytesCount highWaterMark = 0;
     };
 
+    /*
+        Pool of objects to deserialize into.
+        Deserializer decodes vectors, lists and deques in place, so recycled object keeps memory of its elements(strings, nested containers)
+        and next message of the same shape is decoded without allocations.
+        Context is not thread-safe, 'threadLocal()' gives separate instance for every thread.
+    */
+    class DeserializationContext
+    {
+    public:
+        // returns previously recycled object of type T or new one
+        template<typename T>
+        T acquire()
+        {
+            std::vector<T>& objects = pool<T>().objects;
+            if(objects.empty()) return T{};
+            T obj = std::move(objects.back());
+            objects.pop_back();
+            return obj;
+        }
+
+        // takes only rvalues, so object of caller is never moved from silently(use std::move)
+        template<typename T, typename = std::enable_if_t<!std::is_lvalue_reference<T>::value>>
+        void recycle(T&& obj)
+        {
+            std::vector<T>& objects = pool<T>().objects;
+            if(objects.size() < MaxPooledObjects) objects.push_back(std::move(obj));
+        }
+
+        /*
+            Acquires object of type T and deserializes it from 'buf'.
+            Recycled user type(not IsFullyDeserialized) is reset to T{} first, so it has no members of previous object.
+        */
+        template<typename T>
+        T deserialize(const std::string& buf, BytesCount offset, BytesCount* read = nullptr)
+        {
+            T obj = acquire<T>();
+            if constexpr(!IsFullyDeserialized<T>::value) obj = T{};
+            BytesCount b = Deserializer::deserializeAll(buf, offset, &obj);
+            if(read) *read = b;
+            return obj;
+        }
 
+        static DeserializationContext& threadLocal();
 
-    // for vector, list, deque
-    template<typename T>
-    struct Deserializer::DeserializeUnit<T, std::enable_if_t<IsIterable<T>::value>>
+    private:
+        static constexpr size_t MaxPooledObjects = 16;
+
+        struct PoolBase
+        {
+            virtual ~PoolBase() = default;
+        };
+
+        template<typename T>
+        struct Pool : PoolBase
+        {
+            std::vector<T> objects;
+        };
+
+        template<typename T>
+        Pool<T>& pool()
+        {
+            std::unique_ptr<PoolBase>& p = pools[std::type_index(typeid(T))];
+            if(!p) p.reset(new Pool<T>{});
+            return static_cast<Pool<T>&>(*p);
+        }
+
+        std::unordered_map<std::type_index, std::unique_ptr<PoolBase>> pools;
+    };
+
+    /*
+        Patches for incremental updates of containers.
+        serializeDiff() writes patch, that turns 'oldCont' into 'newCont', applyPatch() applies it to container equal to 'oldCont'.
+        Supported containers:
+            - std::map, std::unordered_map - erased keys, then inserted or modified entries(values are compared with operator==);
+            - std::set, std::unordered_set - erased keys, then inserted keys;
+            - std::vector, std::deque - new size, then ranges of changed elements(start index, count, elements).
+    */
+    class ContainerDiff
     {
-        static BytesCount deserializeUnit(const std::string &buf, BytesCount offset, T *data)
+    public:
+        template<typename T, typename Check = void>
+        struct DiffUnit;
+
+        template<typename T>
+        static BytesCount serializeDiff(std::string& buf, const T* oldCont, const T* newCont)
         {
-            data->clear();
-            using ContSize = typename T::size_type;
-            using DataType = typename T::value_type;
-            ContSize contSize;
-            BytesCount internalOffset = offset;
-            internalOffset += DeserializeUnit<ContSize>::deserializeUnit(buf, internalOffset, &contSize);
-            for(ContSize i = 0; i < contSize; ++i)
+            return DiffUnit<T>::serializeDiff(buf, oldCont, newCont);
+        }
+
+        template<typename T>
+        static BytesCount applyPatch(const std::string& buf, BytesCount offset, T* target)
+        {
+            return DiffUnit<T>::applyPatch(buf, offset, target);
+        }
+
+    private:
+        template<typename T>
+        static BytesCount serializeValue(std::string& buf, const T& value)
+        {
+            return Serializer::SerializeUnit<T>::serializeUnit(buf, const_cast<T*>(&value));
+        }
+
+        // writes placeholder, that is overwritten by writeCount()
+        static BytesCount reserveCount(std::string& buf)
+        {
+            ElementsCount count = 0;
+            return Serializer::SerializeUnit<ElementsCount>::serializeUnit(buf, &count);
+        }
+
+        static void writeCount(std::string& buf, BytesCount countOffset, ElementsCount count)
+        {
+            memcpy(&buf[countOffset], &count, sizeof(count));
+        }
+
+        template<typename T>
+        static BytesCount readCount(const std::string& buf, BytesCount offset, ElementsCount* count)
+        {
+            BytesCount read = Deserializer::DeserializeUnit<ElementsCount>::deserializeUnit(buf, offset, count);
+            Deserializer::checkElements(buf, offset + read, *count, std::max<BytesCount>(MinSerializedSize<T>::value, 1));
+            return read;
+        }
+
+        template<typename T>
+        static BytesCount serializeErased(std::string& buf, const T* oldCont, const T* newCont)
+        {
+            BytesCount countOffset = buf.size();
+            BytesCount written = reserveCount(buf);
+            ElementsCount count = 0;
+            for(const auto& value : *oldCont)
+            {
+                const auto& key = KeyOf<T>::get(value);
+                if(newCont->find(key) == newCont->end())
+                {
+                    written += serializeValue(buf, key);
+                    ++count;
+                }
+            }
+            writeCount(buf, countOffset, count);
+            return written;
+        }
+
+        template<typename T>
+        static BytesCount applyErased(const std::string& buf, BytesCount offset, T* target)
+        {
+            typedef typename T::key_type KeyType;
+            ElementsCount count;
+            BytesCount internalOffset = offset + readCount<KeyType>(buf, offset, &count);
+            KeyType key;
+            for(ElementsCount i = 0; i < count; ++i)
             {
-                DataType dataPiece;
-                internalOffset += DeserializeUnit<DataType>::deserializeUnit(buf, internalOffset, &dataPiece);
-                ContainerSerializerHelper::ContainerAdder<T>::addTo(data, &dataPiece);
+                internalOffset += Deserializer::DeserializeUnit<KeyType>::deserializeUnit(buf, internalOffset, &key);
+                target->erase(key);
             }
             return internalOffset - offset;
         }
-    };
 
+        template<typename T, typename = void>
+        struct KeyOf
+        {
+            static const typename T::key_type& get(const typename T::value_type& value) { return value; }
+        };
 
-    // for std::string
-    template<>
-    struct Deserializer::DeserializeUnit<std::string>
+        template<typename T>
+        struct KeyOf<T, void_t<typename T::mapped_type>>
+        {
+            static const typename T::key_type& get(const typename T::value_type& value) { return value.first; }
+        };
+    };
+
+    // std::map, std::unordered_map
+    template<typename T>
+    struct ContainerDiff::DiffUnit<T, std::enable_if_t<IsMap<T>::value || IsUndorderedMap<T>::value>>
     {
-        DeserializeUnit() = default;
+        static BytesCount serializeDiff(std::string& buf, const T* oldCont, const T* newCont)
+        {
+            BytesCount written = serializeErased(buf, oldCont, newCont);
+            BytesCount countOffset = buf.size();
+            written += reserveCount(buf);
+            ElementsCount count = 0;
+            for(const auto& value : *newCont)
+            {
+                auto oldIter = oldCont->find(value.first);
+                if(oldIter == oldCont->end() || !(oldIter->second == value.second))
+                {
+                    written += serializeValue(buf, value.first);
+                    written += serializeValue(buf, value.second);
+                    ++count;
+                }
+            }
+            writeCount(buf, countOffset, count);
+            return written;
+        }
 
-        static BytesCount deserializeUnit(const std::string& buf, BytesCount offset, std::string* data)
+        static BytesCount applyPatch(const std::string& buf, BytesCount offset, T* target)
         {
-            data->clear();
-            using ContSize = typename std::string::size_type;
-            ContSize contSize;
-            BytesCount internalOffset = offset;
-            internalOffset += DeserializeUnit<ContSize>::deserializeUnit(buf, internalOffset, &contSize);
-            data->resize(contSize);
-            memcpy(&((*data)[0]), &buf[internalOffset], contSize);
-            internalOffset += contSize;
+            typedef typename T::key_type KeyType;
+            typedef typename T::mapped_type MappedType;
+            BytesCount internalOffset = offset + applyErased(buf, offset, target);
+            ElementsCount count;
+            internalOffset += readCount<std::pair<KeyType, MappedType>>(buf, internalOffset, &count);
+            KeyType key;
+            for(ElementsCount i = 0; i < count; ++i)
+            {
+                internalOffset += Deserializer::DeserializeUnit<KeyType>::deserializeUnit(buf, internalOffset, &key);
+                // modified values are decoded in place
+                MappedType& value = (*target)[key];
+                internalOffset += Deserializer::DeserializeUnit<MappedType>::deserializeUnit(buf, internalOffset, &value);
+            }
             return internalOffset - offset;
         }
     };
 
-
-    // for user type
+    // std::set, std::unordered_set
     template<typename T>
-    struct Deserializer::DeserializeUnit<T, std::enable_if_t<IsDeserializable<T>::value>>
+    struct ContainerDiff::DiffUnit<T, std::enable_if_t<IsSet<T>::value || IsUnorderedSet<T>::value>>
     {
-        DeserializeUnit() = default;
+        static BytesCount serializeDiff(std::string& buf, const T* oldCont, const T* newCont)
+        {
+            return serializeErased(buf, oldCont, newCont) + serializeErased(buf, newCont, oldCont);
+        }
 
-        static BytesCount deserializeUnit(const std::string& buf, BytesCount offset, T* data)
+        static BytesCount applyPatch(const std::string& buf, BytesCount offset, T* target)
         {
-            return data->deserialize(buf, offset);
+            typedef typename T::key_type KeyType;
+            BytesCount internalOffset = offset + applyErased(buf, offset, target);
+            ElementsCount count;
+            internalOffset += readCount<KeyType>(buf, internalOffset, &count);
+            for(ElementsCount i = 0; i < count; ++i)
+            {
+                KeyType key;
+                internalOffset += Deserializer::DeserializeUnit<KeyType>::deserializeUnit(buf, internalOffset, &key);
+                target->insert(std::move(key));
+            }
+            return internalOffset - offset;
         }
     };
 
-
-    // for user type with multiple serializators
+    // std::vector, std::deque
     template<typename T>
-    struct Deserializer::DeserializeUnit<T, std::enable_if_t<IsMultipleDeserializable<T>::value>>
+    struct ContainerDiff::DiffUnit<T, std::enable_if_t<(IsVector<T>::value || IsDeque<T>::value) && !IsBoolVector<T>::value>>
     {
-        DeserializeUnit() = default;
+        typedef typename T::value_type ValueType;
+        typedef typename T::size_type ContSize;
+        static constexpr bool Contiguous = IsVector<T>::value && IsTriviallySerializable<ValueType>::value;
 
-        static BytesCount deserializeUnit(const std::string& buf, BytesCount offset, T* data)
+        static BytesCount serializeDiff(std::string& buf, const T* oldCont, const T* newCont)
         {
-            return data->deserialize(buf, offset);
+            ContSize newSize = newCont->size();
+            ContSize commonSize = std::min(oldCont->size(), newSize);
+            BytesCount written = Serializer::SerializeUnit<ContSize>::serializeUnit(buf, &newSize);
+            BytesCount countOffset = buf.size();
+            written += reserveCount(buf);
+            ElementsCount count = 0;
+            ContSize i = 0;
+            while(i < commonSize)
+            {
+                if((*oldCont)[i] == (*newCont)[i])
+                {
+                    ++i;
+                    continue;
+                }
+                ContSize start = i;
+                ContSize end = ++i;
+                while(i < commonSize)
+                {
+                    if(!((*oldCont)[i] == (*newCont)[i]))
+                    {
+                        end = ++i;
+                    }
+                    // for small values unchanged gap is cheaper than header of next range
+                    else if(Contiguous && (i + 1 - end) * sizeof(ValueType) < 2 * sizeof(ElementsCount))
+                    {
+                        ++i;
+                    }
+                    else
+                    {
+                        break;
+                    }
+                }
+                // elements appended after the end are joined to the last range, if it touches them
+                if(end == commonSize && newSize > commonSize)
+                {
+                    end = newSize;
+                }
+                written += serializeRange(buf, newCont, start, end);
+                ++count;
+                i = end;
+            }
+            if(i < newSize)
+            {
+                written += serializeRange(buf, newCont, i, newSize);
+                ++count;
+            }
+            writeCount(buf, countOffset, count);
+            return written;
         }
-    };
-
 
-    /*
-        std::pair
-    */
-    template<typename T1, typename T2>
-    struct Deserializer::DeserializeUnit<std::pair<T1, T2>>
-    {
-        DeserializeUnit() = default;
+        static BytesCount applyPatch(const std::string& buf, BytesCount offset, T* target)
+        {
+            ContSize newSize;
+            BytesCount internalOffset = offset + Deserializer::DeserializeUnit<ContSize>::deserializeUnit(buf, offset, &newSize);
+            ElementsCount count;
+            internalOffset += Deserializer::DeserializeUnit<ElementsCount>::deserializeUnit(buf, internalOffset, &count);
+            // new elements must be in the patch, so size can't grow more than buffer allows
+            if(newSize > target->size())
+            {
+                Deserializer::checkElements(buf, internalOffset, newSize - target->size(), std::max<BytesCount>(MinSerializedSize<ValueType>::value, 1));
+            }
+            Deserializer::checkElements(buf, internalOffset, count, 2 * sizeof(ElementsCount));
+            target->resize(newSize);
+            for(ElementsCount r = 0; r < count; ++r)
+            {
+                ElementsCount start, size;
+                internalOffset += Deserializer::DeserializeUnit<ElementsCount>::deserializeUnit(buf, internalOffset, &start);
+                internalOffset += Deserializer::DeserializeUnit<ElementsCount>::deserializeUnit(buf, internalOffset, &size);
+                if(start > newSize || size > newSize - start) throw SerializerExceptions::OutOfBounds{"applyPatch() - range is out of container"};
+                Deserializer::checkElements(buf, internalOffset, size, std::max<BytesCount>(MinSerializedSize<ValueType>::value, 1));
+                if constexpr(Contiguous)
+                {
+                    if(size > 0)
+                    {
+                        memcpy(&(*target)[start], &buf[internalOffset], size * sizeof(ValueType));
+                    }
+                    internalOffset += size * sizeof(ValueType);
+                }
+                else
+                {
+                    for(ElementsCount i = start; i < start + size; ++i)
+                    {
+                        internalOffset += Deserializer::DeserializeUnit<ValueType>::deserializeUnit(buf, internalOffset, &(*target)[i]);
+                    }
+                }
+            }
+            return internalOffset - offset;
+        }
 
-        static BytesCount deserializeUnit(const std::string& buf, BytesCount offset, std::pair<T1, T2>* data)
+    private:
+        static BytesCount serializeRange(std::string& buf, const T* cont, ElementsCount start, ElementsCount end)
         {
-            typedef std::remove_const_t<T1> NonConstT1;
-            // throwing away const, because std containers, such as std::unordered_map, use const Key in their value type
-            return deserializeAll(buf, offset, const_cast<NonConstT1*>(&data->first), &data->second);
+            ElementsCount size = end - start;
+            BytesCount written = Serializer::SerializeUnit<ElementsCount>::serializeUnit(buf, &start);
+            written += Serializer::SerializeUnit<ElementsCount>::serializeUnit(buf, &size);
+            if constexpr(Contiguous)
+            {
+                buf.append(reinterpret_cast<const char*>(cont->data() + start), size * sizeof(ValueType));
+                return written + size * sizeof(ValueType);
+            }
+            for(ElementsCount i = start; i < end; ++i)
+            {
+                written += serializeValue(buf, (*cont)[i]);
+            }
+            return written;
         }
     };
 
 }
-
-
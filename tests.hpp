@@ -1,7 +1,20 @@
 #pragma once
 #include <gtest/gtest.h>
 #include <unordered_map>
+#include <random>
+#include <sstream>
+#include <iterator>
+#include <fstream>
+#include <thread>
+#if __cplusplus >= 202002L
+#include <ranges>
+#endif
 #include "serializer.hpp"
+#include "ringbuffer.hpp"
+#include "mappedfile.hpp"
+#include "recordlog.hpp"
+#include "batchdecoder.hpp"
+#include "flatcontainers.hpp"
 
 namespace S = Serialization;
 
@@ -37,6 +50,55 @@ struct User : public Serialization::Serializable, public Serialization::Deserial
 
 };
 
+struct Event : public S::PolymorphicSerializable
+{
+    uint64_t timestamp = 0;
+};
+
+struct Click : public S::RegisteredType<Click, Event, 1>
+{
+    int x = 0;
+    int y = 0;
+
+    S::BytesCount serialize(std::string& buf)
+    {
+        return S::Serializer::serializeAll(buf, &timestamp, &x, &y);
+    }
+
+    S::BytesCount deserialize(const std::string& buf, S::BytesCount offset)
+    {
+        return S::Deserializer::deserializeAll(buf, offset, &timestamp, &x, &y);
+    }
+};
+
+struct KeyPress : public S::RegisteredType<KeyPress, Event, 2>
+{
+    std::string keys;
+
+    S::BytesCount serialize(std::string& buf)
+    {
+        return S::Serializer::serializeAll(buf, &timestamp, &keys);
+    }
+
+    S::BytesCount deserialize(const std::string& buf, S::BytesCount offset)
+    {
+        return S::Deserializer::deserializeAll(buf, offset, &timestamp, &keys);
+    }
+};
+
+static const bool eventsRegistered = S::TypeRegistry<Event>::registerTypes<Click, KeyPress>();
+
+// counts hash computations
+struct CountingHash
+{
+    size_t operator()(const std::string& s) const
+    {
+        ++calls;
+        return std::hash<std::string>{}(s);
+    }
+    static inline size_t calls = 0;
+};
+
 struct Cat : public S::MultipleSerializable, public S::MultipleDeserializable
 {
     enum {NameLegsSerializer, AllSerializer, NameLegsDeserializer, AllDeserializer};
@@ -427,8 +489,10 @@ TEST(ArraysTest, SerializerTest)
 
     ArrayWrapper<int> aw11;
     aw11.start = new int[5];
+    aw11.capacity = 5;
     ArrayWrapper<double> aw21;
     aw21.start = new double[4];
+    aw21.capacity = 4;
 
     BytesCount b1 = Deserializer::deserializeAll(buf, 0, &aw11, &aw21);
 
@@ -450,6 +514,62 @@ TEST(ArraysTest, SerializerTest)
     EXPECT_EQ(b, b1);
     EXPECT_EQ(arr.size(), arr1.size());
     EXPECT_TRUE(areContainersEqual(arr, arr1));
+
+    // not enough capacity
+    ArrayWrapper<int> aw32{arr1.data(), 5};
+    EXPECT_THROW(Deserializer::deserializeAll(buf, 0, &aw32), SerializerExceptions::InvalidArgs);
+
+    delete[] pi;
+    delete[] pd;
+    delete[] aw11.start;
+    delete[] aw21.start;
+}
+
+TEST(NonTrivialArraysTest, SerializerTest)
+{
+    using namespace Serialization;
+    std::string buf;
+
+    std::string strs[3]{"neko", "", "wanko desu"};
+    ArrayWrapper<std::string> aws{strs, 3};
+    int i = 7;
+    BytesCount b = Serializer::serializeAll(buf, &aws, &i);
+    EXPECT_EQ(b, sizeof(ElementsCount) + sizeof(BytesCount) * 3 + 4 + 10 + sizeof(int));
+
+    std::string strs1[4];
+    ArrayWrapper<std::string> aws1{strs1, 0, 4};
+    int i1;
+    BytesCount b1 = Deserializer::deserializeAll(buf, 0, &aws1, &i1);
+    EXPECT_EQ(b, b1);
+    EXPECT_EQ(aws1.size, 3);
+    EXPECT_EQ(strs1[0], strs[0]);
+    EXPECT_EQ(strs1[1], strs[1]);
+    EXPECT_EQ(strs1[2], strs[2]);
+    EXPECT_EQ(i, i1);
+
+    // owning wrapper allocates memory itself
+    OwningArrayWrapper<std::string> owned;
+    b1 = Deserializer::deserializeAll(buf, 0, &owned, &i1);
+    EXPECT_EQ(b, b1);
+    EXPECT_EQ(owned.size, 3);
+    EXPECT_GE(owned.capacity, 3);
+    EXPECT_EQ(owned.start[2], strs[2]);
+
+    buf.clear();
+    std::vector<double> vd{1.5, 2.5, 3.5};
+    ArrayWrapper<double> awd{vd.data(), vd.size()};
+    Serializer::serializeAll(buf, &awd);
+    OwningArrayWrapper<double> ownedd(1);
+    Deserializer::deserializeAll(buf, 0, &ownedd);
+    EXPECT_EQ(ownedd.size, 3);
+    EXPECT_EQ(ownedd.start[1], 2.5);
+
+    // corrupted count must not lead to huge allocation
+    ElementsCount huge = ElementsCount(1) << 60;
+    buf.clear();
+    Serializer::serializeAll(buf, &huge);
+    OwningArrayWrapper<double> ownedd1;
+    EXPECT_THROW(Deserializer::deserializeAll(buf, 0, &ownedd1), SerializerExceptions::OutOfBounds);
 }
 
 TEST(VariousTest, SerializerTest)
@@ -478,3 +598,1415 @@ TEST(VariousTest, SerializerTest)
     EXPECT_TRUE(areContainersEqual(vs, vs5));
     EXPECT_TRUE(areContainersEqual(vs2, vs6));
 }
+
+
+
+/*
+    Generates random values for property-based round trip tests.
+    Depth of nesting is defined by type itself, 'maxSize' limits size of each container.
+*/
+template<typename T, typename = void>
+struct RandomValue;
+
+template<typename T>
+struct RandomValue<T, std::enable_if_t<std::is_arithmetic<T>::value>>
+{
+    static T make(std::mt19937& rng, size_t)
+    {
+        if constexpr(std::is_floating_point<T>::value) return std::uniform_real_distribution<T>{-1e6, 1e6}(rng);
+        else return static_cast<T>(rng());
+    }
+};
+
+template<>
+struct RandomValue<std::string>
+{
+    static std::string make(std::mt19937& rng, size_t maxSize)
+    {
+        std::string s(rng() % (maxSize + 1), '\0');
+        for(auto& c : s) c = static_cast<char>(rng());
+        return s;
+    }
+};
+
+template<typename T1, typename T2>
+struct RandomValue<std::pair<T1, T2>>
+{
+    static std::pair<T1, T2> make(std::mt19937& rng, size_t maxSize)
+    {
+        return {RandomValue<std::remove_const_t<T1>>::make(rng, maxSize), RandomValue<T2>::make(rng, maxSize)};
+    }
+};
+
+template<typename T>
+struct RandomValue<T, std::enable_if_t<IsIterable<T>::value && !IsString<T>::value>>
+{
+    static T make(std::mt19937& rng, size_t maxSize)
+    {
+        T cont;
+        size_t sz = rng() % (maxSize + 1);
+        for(size_t i = 0; i < sz; ++i)
+        {
+            auto val = RandomValue<std::remove_const_t<typename T::value_type>>::make(rng, maxSize);
+            S::ContainerSerializerHelper::ContainerAdder<T>::addTo(&cont, &val);
+        }
+        return cont;
+    }
+};
+
+template<typename T>
+void checkRandomRoundTrip(std::mt19937& rng, size_t iterations, size_t maxSize)
+{
+    using namespace Serialization;
+    for(size_t i = 0; i < iterations; ++i)
+    {
+        T value = RandomValue<T>::make(rng, maxSize);
+        std::string buf;
+        BytesCount b = Serializer::serializeAll(buf, &value);
+        ASSERT_EQ(b, buf.size());
+
+        T value1;
+        BytesCount b1 = Deserializer::deserializeAll(buf, 0, &value1);
+        ASSERT_EQ(b, b1);
+        ASSERT_TRUE(value == value1);
+
+        // every truncated buffer must be rejected
+        for(size_t len = 0; len < buf.size(); len += 1 + buf.size() / 16)
+        {
+            T truncated;
+            EXPECT_THROW(Deserializer::deserializeAll(buf.substr(0, len), 0, &truncated), SerializerExceptions::OutOfBounds);
+        }
+    }
+}
+
+TEST(RandomRoundTripTest, SerializerTest)
+{
+    std::mt19937 rng(42);
+    checkRandomRoundTrip<double>(rng, 100, 8);
+    checkRandomRoundTrip<std::string>(rng, 100, 64);
+    checkRandomRoundTrip<std::vector<std::vector<int>>>(rng, 100, 8);
+    checkRandomRoundTrip<std::list<std::deque<std::string>>>(rng, 100, 6);
+    checkRandomRoundTrip<std::map<std::string, std::vector<short>>>(rng, 100, 8);
+    checkRandomRoundTrip<std::unordered_map<int, std::set<std::string>>>(rng, 100, 6);
+    checkRandomRoundTrip<std::multiset<std::pair<char, std::string>>>(rng, 100, 8);
+    checkRandomRoundTrip<std::vector<std::map<int, std::vector<std::string>>>>(rng, 50, 5);
+}
+
+template<typename Context, typename T, typename = void>
+struct CanRecycle : std::false_type {};
+
+template<typename Context, typename T>
+struct CanRecycle<Context, T, std::void_t<decltype(std::declval<Context&>().recycle(std::declval<T>()))>> : std::true_type {};
+
+// 'note' is local state, it is not serialized
+struct Annotated : public S::Serializable, public S::Deserializable
+{
+    int id = 0;
+    std::string note;
+
+    S::BytesCount serialize(std::string& buf) { return S::Serializer::serializeAll(buf, &id); }
+    S::BytesCount deserialize(const std::string& buf, S::BytesCount offset) { return S::Deserializer::deserializeAll(buf, offset, &id); }
+};
+
+TEST(ContextsTest, SerializerTest)
+{
+    using namespace Serialization;
+
+    SerializationContext& sctx = SerializationContext::threadLocal();
+    User user;
+    user.age = 22;
+    user.name = "Vasya";
+    user.hobbies = {"swimming", "anime", "fishing"};
+
+    const std::string& buf = sctx.serialize(&user);
+    BytesCount size = buf.size();
+    EXPECT_EQ(sctx.getHighWaterMark(), size);
+    const char* data = buf.data();
+
+    // the same buffer is reused
+    const std::string& buf1 = sctx.serialize(&user);
+    EXPECT_EQ(buf1.size(), size);
+    EXPECT_EQ(buf1.data(), data);
+
+    std::string taken = sctx.takeBuffer();
+    EXPECT_EQ(taken.size(), size);
+    EXPECT_GE(sctx.buffer().capacity(), size);
+    sctx.recycle(std::move(taken));
+
+    DeserializationContext& dctx = DeserializationContext::threadLocal();
+    std::vector<std::string> vs{std::string(100, 'a'), std::string(200, 'b')};
+    std::string buf2;
+    Serializer::serializeAll(buf2, &vs);
+
+    auto vs1 = dctx.deserialize<std::vector<std::string>>(buf2, 0);
+    EXPECT_EQ(vs, vs1);
+    const char* inner = vs1[1].data();
+    dctx.recycle(std::move(vs1));
+    // lvalues are not accepted, they would be moved from
+    static_assert(!CanRecycle<DeserializationContext, std::vector<std::string>&>::value);
+    static_assert(CanRecycle<DeserializationContext, std::vector<std::string>&&>::value);
+
+    // recycled object keeps memory of its elements
+    std::vector<std::string> vs2{"short", "strings"};
+    buf2.clear();
+    Serializer::serializeAll(buf2, &vs2);
+    BytesCount read;
+    auto vs3 = dctx.deserialize<std::vector<std::string>>(buf2, 0, &read);
+    EXPECT_EQ(read, buf2.size());
+    EXPECT_EQ(vs2, vs3);
+    EXPECT_EQ(vs3[1].data(), inner);
+
+    // reused elements of user types don't keep members that are not deserialized
+    static_assert(IsFullyDeserialized<std::map<int, std::vector<std::string>>>::value && !IsFullyDeserialized<Annotated>::value);
+    std::vector<Annotated> written(3);
+    for(int i = 0; i < 3; ++i) written[i].id = i + 1;
+    buf2.clear();
+    Serializer::serializeAll(buf2, &written);
+    std::vector<Annotated> va(2);
+    std::list<Annotated> la(5);
+    for(auto& a : va) a.note = "stale";
+    for(auto& a : la) a.note = "stale";
+    Deserializer::deserializeAll(buf2, 0, &va);
+    Deserializer::deserializeAll(buf2, 0, &la);
+    EXPECT_EQ(va.size(), 3);
+    EXPECT_EQ(la.size(), 3);
+    EXPECT_TRUE(std::all_of(va.begin(), va.end(), [](const Annotated& a) { return a.note.empty(); }));
+    EXPECT_TRUE(std::all_of(la.begin(), la.end(), [](const Annotated& a) { return a.note.empty(); }));
+    EXPECT_EQ(va[2].id, 3);
+    EXPECT_EQ(la.back().id, 3);
+
+    Annotated recycled;
+    recycled.note = "stale";
+    dctx.recycle(std::move(recycled));
+    buf2.clear();
+    Serializer::serializeAll(buf2, &written[0]);
+    Annotated acquired = dctx.deserialize<Annotated>(buf2, 0);
+    EXPECT_EQ(acquired.id, 1);
+    EXPECT_TRUE(acquired.note.empty());
+}
+
+TEST(ChecksumTest, SerializerTest)
+{
+    using namespace Serialization;
+
+    EXPECT_EQ(Crc32c::compute("123456789", 9), 0xE3069283u);
+    // computing by parts gives the same result
+    EXPECT_EQ(Crc32c::compute("56789", 5, Crc32c::compute("1234", 4)), 0xE3069283u);
+
+    // RFC 3720 vectors for both implementations
+    unsigned char zeros[32] = {}, ones[32], asc[32], desc[32];
+    for(int k = 0; k < 32; ++k)
+    {
+        ones[k] = 0xFF;
+        asc[k] = static_cast<unsigned char>(k);
+        desc[k] = static_cast<unsigned char>(31 - k);
+    }
+    for(auto compute : {&Crc32c::compute, &Crc32c::computeSoftware})
+    {
+        EXPECT_EQ(compute("123456789", 9, 0), 0xE3069283u);
+        EXPECT_EQ(compute(zeros, 32, 0), 0x8A9136AAu);
+        EXPECT_EQ(compute(ones, 32, 0), 0x62A8AB43u);
+        EXPECT_EQ(compute(asc, 32, 0), 0x46DD794Eu);
+        EXPECT_EQ(compute(desc, 32, 0), 0x113FDB5Cu);
+    }
+    // software tables give the same result as hardware instruction on every length and alignment
+    std::mt19937 rng(29);
+    std::string random(300, 0);
+    for(auto& c : random) c = static_cast<char>(rng());
+    for(size_t start = 0; start < 9; ++start)
+    {
+        for(size_t size = 0; start + size <= random.size(); size += 7)
+        {
+            Crc32c::Checksum seed = rng();
+            EXPECT_EQ(Crc32c::computeSoftware(&random[start], size, seed), Crc32c::compute(&random[start], size, seed));
+        }
+    }
+
+    std::string buf;
+    int i = 5;
+    std::map<std::string, std::vector<double>> m{{"neko", {1.1, 2.2}}, {"wanko", {3.3}}};
+    BytesCount b = Serializer::serializeAllChecked(buf, &i, &m);
+    EXPECT_EQ(b, buf.size());
+
+    int i1;
+    decltype(m) m1;
+    BytesCount b1 = Deserializer::deserializeAllChecked(buf, 0, &i1, &m1);
+    EXPECT_EQ(b, b1);
+    EXPECT_EQ(i, i1);
+    EXPECT_EQ(m, m1);
+
+    // any flipped bit is detected before decoding, arguments are not changed
+    for(size_t pos = 0; pos < buf.size(); ++pos)
+    {
+        for(int bit = 0; bit < 8; ++bit)
+        {
+            std::string corrupted = buf;
+            corrupted[pos] ^= static_cast<char>(1 << bit);
+            int i2 = -1;
+            decltype(m) m2{{"kept", {}}};
+            EXPECT_THROW(Deserializer::deserializeAllChecked(corrupted, 0, &i2, &m2), SerializerExceptions::ChecksumMismatch) << "at " << pos;
+            EXPECT_EQ(i2, -1);
+            EXPECT_EQ(m2.size(), 1);
+        }
+    }
+
+    // data that is intact but doesn't match arguments
+    std::string small;
+    short sh = 1;
+    Serializer::serializeAllChecked(small, &sh);
+    Serializer::serializeAll(small, &sh);
+    EXPECT_THROW(Deserializer::deserializeAllChecked(small, 0, &i1), SerializerExceptions::InvalidArgs);
+}
+
+TEST(CompactEncodingsTest, SerializerTest)
+{
+    using namespace Serialization;
+    std::mt19937 rng(7);
+
+    std::vector<int16_t> vs(1000);
+    std::vector<uint32_t> vu(1000);
+    std::vector<int64_t> vl(1000);
+    for(size_t i = 0; i < vs.size(); ++i)
+    {
+        // mostly small values with rare big ones, so both block and scalar paths are used
+        bool big = rng() % 50 == 0;
+        vs[i] = static_cast<int16_t>(big ? rng() : rng() % 128 - 64);
+        vu[i] = big ? rng() : rng() % 128;
+        vl[i] = big ? static_cast<int64_t>(uint64_t(rng()) << 32 | rng()) : static_cast<int64_t>(rng() % 128) - 64;
+    }
+
+    std::string reference;
+    for(auto level : {VarintCodec::Level::Scalar, VarintCodec::Level::SSE41, VarintCodec::Level::AVX2})
+    {
+        VarintCodec::setLevel(level);
+        std::string buf;
+        VarintWrapper<int16_t> ws{&vs};
+        VarintWrapper<uint32_t> wu{&vu};
+        VarintWrapper<int64_t> wl{&vl};
+        BytesCount b = Serializer::serializeAll(buf, &ws, &wu, &wl);
+        EXPECT_EQ(b, buf.size());
+        EXPECT_LT(b, vs.size() * sizeof(int16_t) + vu.size() * sizeof(uint32_t) + vl.size() * sizeof(int64_t));
+        // all implementations produce the same bytes
+        if(reference.empty()) reference = buf;
+        EXPECT_EQ(reference, buf);
+
+        std::vector<int16_t> vs1;
+        std::vector<uint32_t> vu1;
+        std::vector<int64_t> vl1;
+        VarintWrapper<int16_t> ws1{&vs1};
+        VarintWrapper<uint32_t> wu1{&vu1};
+        VarintWrapper<int64_t> wl1{&vl1};
+        BytesCount b1 = Deserializer::deserializeAll(buf, 0, &ws1, &wu1, &wl1);
+        EXPECT_EQ(b, b1);
+        EXPECT_EQ(vs, vs1);
+        EXPECT_EQ(vu, vu1);
+        EXPECT_EQ(vl, vl1);
+
+        EXPECT_THROW(Deserializer::deserializeAll(buf.substr(0, buf.size() - 1), 0, &ws1, &wu1, &wl1), SerializerExceptions::OutOfBounds);
+    }
+    VarintCodec::setLevel(VarintCodec::Level::AVX2);
+
+    std::vector<bool> vb{true, false, false, true, true, true, false, true, false, true};
+    std::string buf;
+    BytesCount b = Serializer::serializeAll(buf, &vb);
+    EXPECT_EQ(b, sizeof(size_t) + 2);
+    std::vector<bool> vb1;
+    BytesCount b1 = Deserializer::deserializeAll(buf, 0, &vb1);
+    EXPECT_EQ(b, b1);
+    EXPECT_EQ(vb, vb1);
+
+    // sizes around byte and word boundaries, compared with packing bit by bit
+    for(size_t size : {0, 1, 7, 8, 9, 63, 64, 65, 127, 128, 129, 1000})
+    {
+        std::vector<bool> bits(size + 5);
+        for(size_t i = 0; i < bits.size(); ++i) bits[i] = rng() % 2;
+        // bits after size stay in memory of vector, they must not be written
+        bits.resize(size);
+        std::string expected((size + 7) / 8, 0);
+        for(size_t i = 0; i < size; ++i) expected[i / 8] |= static_cast<char>(bits[i] << (i % 8));
+        buf.clear();
+        Serializer::serializeAll(buf, &bits);
+        EXPECT_EQ(buf.substr(sizeof(size_t)), expected) << size;
+        // unused bits of the last byte are ignored
+        if(size % 8) buf.back() |= static_cast<char>(0x80);
+        std::vector<bool> decoded(3, true);
+        Deserializer::deserializeAll(buf, 0, &decoded);
+        EXPECT_EQ(decoded, bits) << size;
+    }
+}
+
+// input iterator that can't be copied, as iterator of std::generator
+struct MoveOnlyCounter
+{
+    struct End {};
+
+    MoveOnlyCounter(int _value, int _end)
+        : value{_value}, end{_end} {}
+    MoveOnlyCounter(MoveOnlyCounter&&) = default;
+    MoveOnlyCounter& operator=(MoveOnlyCounter&&) = default;
+
+    int operator*() const { return value * 10; }
+    MoveOnlyCounter& operator++() { ++value; return *this; }
+    bool operator!=(End) const { return value != end; }
+
+    int value;
+    int end;
+};
+
+TEST(RangesTest, SerializerTest)
+{
+    using namespace Serialization;
+    std::string buf;
+
+    // part of container
+    std::vector<std::string> vs{"a", "bb", "ccc", "dddd"};
+    auto part = makeRangeWrapper(vs.begin() + 1, vs.end());
+    BytesCount b = Serializer::serializeAll(buf, &part);
+
+    std::vector<std::string> vs1;
+    BytesCount b1 = Deserializer::deserializeAll(buf, 0, &vs1);
+    EXPECT_EQ(b, b1);
+    EXPECT_EQ(vs1, std::vector<std::string>(vs.begin() + 1, vs.end()));
+
+    // input iterators, size is not known beforehand
+    buf.clear();
+    std::istringstream in("1 2 3 4 5");
+    auto stream = makeRangeWrapper(std::istream_iterator<int>(in), std::istream_iterator<int>());
+    int i = 7;
+    b = Serializer::serializeAll(buf, &stream, &i);
+
+    std::list<int> li;
+    int i1;
+    b1 = Deserializer::deserializeAll(buf, 0, &li, &i1);
+    EXPECT_EQ(b, b1);
+    EXPECT_EQ(li, std::list<int>({1, 2, 3, 4, 5}));
+    EXPECT_EQ(i, i1);
+
+    // generator
+    buf.clear();
+    int n = 0;
+    GeneratorWrapper gen{[&n]() { return n < 4 ? std::optional<std::string>(std::string(++n, 'x')) : std::nullopt; }};
+    b = Serializer::serializeAll(buf, &gen);
+
+    // reading without building container
+    std::vector<size_t> sizes;
+    b1 = Deserializer::deserializeEach<std::string>(buf, 0, [&sizes](const std::string& s) { sizes.push_back(s.size()); });
+    EXPECT_EQ(b, b1);
+    EXPECT_EQ(sizes, std::vector<size_t>({1, 2, 3, 4}));
+
+    std::deque<std::string> ds;
+    b1 = Deserializer::deserializeInto<std::string>(buf, 0, std::back_inserter(ds));
+    EXPECT_EQ(b, b1);
+    EXPECT_EQ(ds.back(), "xxxx");
+
+    // move-only iterator is advanced in place, copyable one is copied, so its wrapper can be written again
+    buf.clear();
+    auto counter = makeRangeWrapper(MoveOnlyCounter{0, 5}, MoveOnlyCounter::End{});
+    Serializer::serializeAll(buf, &counter);
+    std::vector<int> tens;
+    Deserializer::deserializeAll(buf, 0, &tens);
+    EXPECT_EQ(tens, std::vector<int>({0, 10, 20, 30, 40}));
+    std::string first, second;
+    Serializer::serializeAll(first, &part);
+    Serializer::serializeAll(second, &part);
+    EXPECT_EQ(first, second);
+
+#if __cplusplus >= 202002L
+    buf.clear();
+    auto squares = std::views::iota(1, 6) | std::views::transform([](int x) { return x * x; });
+    auto rw = makeRangeWrapper(squares);
+    Serializer::serializeAll(buf, &rw);
+    std::vector<int> vi;
+    Deserializer::deserializeAll(buf, 0, &vi);
+    EXPECT_EQ(vi, std::vector<int>({1, 4, 9, 16, 25}));
+#endif
+}
+
+TEST(ScatterGatherTest, SerializerTest)
+{
+    using namespace Serialization;
+
+    int i = 5;
+    std::string small = "neko";
+    std::string big(10000, 'b');
+    std::vector<double> vd(2000, 1.5);
+    std::map<int, std::string> m{{1, "wanko"}, {2, std::string(5000, 'm')}};
+
+    std::string expected;
+    BytesCount b = Serializer::serializeAll(expected, &i, &small, &big, &vd, &m);
+
+    ScatterGatherBuffer out(1024);
+    BytesCount b1 = ScatterGatherSerializer::serializeAll(out, &i, &small, &big, &vd, &m);
+    EXPECT_EQ(b, b1);
+    EXPECT_EQ(b, out.size());
+    EXPECT_EQ(expected, out.flatten());
+
+    // large payloads are referenced, not copied
+    auto segments = out.segments();
+    EXPECT_EQ(segments.size(), 6);
+    EXPECT_EQ(segments[1].data, big.data());
+    EXPECT_EQ(segments[3].data, reinterpret_cast<const char*>(vd.data()));
+    EXPECT_EQ(segments[5].data, m[2].data());
+    EXPECT_LT(out.scratch().size(), 100);
+#ifdef SERIALIZER_HAS_IOVEC
+    EXPECT_EQ(out.iovecs().size(), segments.size());
+#endif
+
+    out.clear();
+    EXPECT_EQ(out.size(), 0);
+
+    // scratch-written and referenced arguments alternate, also inside pairs and containers
+    std::pair<std::string, int> p1{std::string(3000, 'p'), 7};
+    std::pair<int, std::string> p2{8, std::string(2000, 'q')};
+    std::vector<std::pair<short, std::string>> vp{{1, "a"}, {2, std::string(4000, 'r')}, {3, "b"}};
+    double d = 2.5;
+    expected.clear();
+    b = Serializer::serializeAll(expected, &d, &big, &i, &p1, &small, &p2, &vp, &vd, &i);
+    b1 = ScatterGatherSerializer::serializeAll(out, &d, &big, &i, &p1, &small, &p2, &vp, &vd, &i);
+    EXPECT_EQ(b, b1);
+    EXPECT_EQ(expected, out.flatten());
+    segments = out.segments();
+    EXPECT_EQ(segments[1].data, big.data());
+    EXPECT_EQ(segments[3].data, p1.first.data());
+}
+
+TEST(RingBufferTest, SerializerTest)
+{
+    using namespace Serialization;
+
+    const int producers = 4;
+    const int perProducer = 5000;
+    // small buffer, so records wrap around many times
+    RingBuffer ring(4096);
+    EXPECT_EQ(ring.getCapacity(), 4096);
+
+    std::vector<std::thread> threads;
+    for(int p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&ring, p]()
+        {
+            for(int i = 0; i < perProducer; ++i)
+            {
+                std::string payload(i % 50, 'a' + p);
+                ring.write(&p, &i, &payload);
+            }
+        });
+    }
+
+    std::vector<int> next(producers, 0);
+    int total = 0;
+    bool ordered = true;
+    while(total < producers * perProducer)
+    {
+        total += ring.consume([&](const char* data, size_t size)
+        {
+            std::string buf(data, size);
+            int p, i;
+            std::string payload;
+            BytesCount b = Deserializer::deserializeAll(buf, 0, &p, &i, &payload);
+            ordered = ordered && b == size && next[p] == i && payload == std::string(i % 50, 'a' + p);
+            next[p] = i + 1;
+        });
+    }
+    for(auto& t : threads) t.join();
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(ring.consumedPosition(), ring.reservedPosition());
+
+    std::string big(ring.maxRecordSize() + 1, 'x');
+    EXPECT_THROW(ring.tryWrite(&big), SerializerExceptions::InvalidArgs);
+    int fixed = 5;
+    EXPECT_THROW(RingBuffer(64).tryWrite(&fixed, &fixed, &fixed, &fixed, &fixed, &fixed, &fixed), SerializerExceptions::InvalidArgs);
+
+    // buffer of thread local serialization context is not used by ring
+    User user;
+    user.name = "Ann";
+    const std::string& serialized = SerializationContext::threadLocal().serialize(&user);
+    std::string copy = serialized;
+    std::string payload = "payload";
+    EXPECT_TRUE(ring.tryWrite(&payload));
+    EXPECT_EQ(serialized, copy);
+    ring.consume([](const char*, size_t) {});
+
+    // records written in place are the same bytes as serializeAll writes, user types go through scratch buffer
+    static_assert(HasDirectLayout<std::map<std::string, std::vector<double>>>::value, "");
+    static_assert(HasDirectLayout<std::list<std::pair<std::string, int>>>::value, "");
+    static_assert(!HasDirectLayout<std::vector<User>>::value && !HasDirectLayout<std::vector<bool>>::value, "");
+    std::map<std::string, std::vector<double>> md{{"a", {1.5, 2.5}}, {"bb", {}}};
+    std::list<std::pair<std::string, int>> lp{{"x", 1}, {"", 2}};
+    std::deque<short> ds{1, 2, 3};
+    std::set<std::string> ss{"neko", "wanko"};
+    std::string_view sv = "view";
+    std::vector<std::vector<int>> vv{{1}, {}, {2, 3}};
+    std::string expected;
+    Serializer::serializeAll(expected, &fixed, &md, &lp, &ds, &ss, &sv, &vv);
+    EXPECT_TRUE(ring.tryWrite(&fixed, &md, &lp, &ds, &ss, &sv, &vv));
+    Serializer::serializeAll(expected, &user, &fixed);
+    ring.write(&user, &fixed);
+    std::string records;
+    ring.consume([&records](const char* data, size_t size) { records.append(data, size); });
+    EXPECT_EQ(records, expected);
+
+    // file sink
+    std::string path = ::testing::TempDir() + "ringbuffer_test.bin";
+    {
+        RingBufferFileSink sink(path, 1 << 12);
+        std::vector<std::thread> writers;
+        for(int p = 0; p < producers; ++p)
+        {
+            writers.emplace_back([&sink, p]()
+            {
+                for(int i = 0; i < 1000; ++i) sink.write(&p, &i);
+            });
+        }
+        for(auto& t : writers) t.join();
+        sink.flush();
+    }
+    std::ifstream in(path, std::ios::binary);
+    std::string file{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    EXPECT_EQ(file.size(), producers * 1000 * 2 * sizeof(int));
+    std::vector<int> counts(producers, 0);
+    for(BytesCount offset = 0; offset < file.size();)
+    {
+        int p, i;
+        offset += Deserializer::deserializeAll(file, offset, &p, &i);
+        EXPECT_EQ(counts[p]++, i);
+    }
+    std::remove(path.c_str());
+
+    // write errors are reported by flush()
+    if(std::ifstream("/dev/full"))
+    {
+        RingBufferFileSink full("/dev/full", 1 << 12);
+        for(int i = 0; i < 100; ++i) full.write(&i);
+        EXPECT_THROW(full.flush(), SerializerExceptions::InvalidArgs);
+        EXPECT_TRUE(full.hasFailed());
+    }
+}
+
+TEST(PolymorphicTypesTest, SerializerTest)
+{
+    using namespace Serialization;
+    EXPECT_TRUE(eventsRegistered);
+
+    std::vector<std::unique_ptr<Event>> events;
+    auto click = std::make_unique<Click>();
+    click->timestamp = 100;
+    click->x = 10;
+    click->y = -20;
+    auto press = std::make_unique<KeyPress>();
+    press->timestamp = 200;
+    press->keys = "ctrl+s";
+    events.push_back(std::move(click));
+    events.push_back(nullptr);
+    events.push_back(std::move(press));
+
+    std::string buf;
+    BytesCount b = Serializer::serializeAll(buf, &events);
+    EXPECT_EQ(b, sizeof(size_t) + (sizeof(TypeId) + 8 + 4 + 4) + sizeof(TypeId) + (sizeof(TypeId) + 8 + sizeof(size_t) + 6));
+
+    std::vector<std::unique_ptr<Event>> events1;
+    BytesCount b1 = Deserializer::deserializeAll(buf, 0, &events1);
+    EXPECT_EQ(b, b1);
+    ASSERT_EQ(events1.size(), 3);
+    ASSERT_NE(dynamic_cast<Click*>(events1[0].get()), nullptr);
+    EXPECT_EQ(events1[0]->timestamp, 100);
+    EXPECT_EQ(static_cast<Click&>(*events1[0]).y, -20);
+    EXPECT_EQ(events1[1], nullptr);
+    ASSERT_NE(dynamic_cast<KeyPress*>(events1[2].get()), nullptr);
+    EXPECT_EQ(static_cast<KeyPress&>(*events1[2]).keys, "ctrl+s");
+
+    // unknown type id
+    buf.clear();
+    TypeId unknown = 1000;
+    Serializer::serializeAll(buf, &unknown);
+    std::unique_ptr<Event> e;
+    EXPECT_THROW(Deserializer::deserializeAll(buf, 0, &e), SerializerExceptions::InvalidType);
+    EXPECT_FALSE(TypeRegistry<Event>::isRegistered(unknown));
+    // id is taken by Click
+    struct Scroll : public RegisteredType<Scroll, Event, 1>
+    {
+        BytesCount serialize(std::string& buf) { return Serializer::serializeAll(buf, &timestamp); }
+        BytesCount deserialize(const std::string& buf, BytesCount offset) { return Deserializer::deserializeAll(buf, offset, &timestamp); }
+    };
+    EXPECT_TRUE(TypeRegistry<Event>::registerType<Click>());
+    EXPECT_THROW(TypeRegistry<Event>::registerType<Scroll>(), SerializerExceptions::InvalidArgs);
+}
+
+TEST(ContainerDiffTest, SerializerTest)
+{
+    using namespace Serialization;
+
+    std::unordered_map<int, std::string> um;
+    for(int i = 0; i < 1000; ++i) um[i] = std::to_string(i);
+    std::unordered_map<int, std::string> um1 = um;
+    um1.erase(5);
+    um1.erase(500);
+    um1[10] = "ten";
+    um1[2000] = "two thousand";
+
+    std::string buf;
+    BytesCount b = ContainerDiff::serializeDiff(buf, &um, &um1);
+    EXPECT_EQ(b, buf.size());
+    EXPECT_EQ(b, 8 + 2 * sizeof(int) + 8 + 2 * (sizeof(int) + 8) + 3 + 12);
+    std::unordered_map<int, std::string> target = um;
+    EXPECT_EQ(b, ContainerDiff::applyPatch(buf, 0, &target));
+    EXPECT_EQ(um1, target);
+
+    std::map<std::string, std::vector<int>> m{{"a", {1}}, {"b", {2, 3}}, {"c", {}}};
+    std::map<std::string, std::vector<int>> m1{{"b", {2, 3, 4}}, {"c", {}}, {"d", {5}}};
+    buf.clear();
+    b = ContainerDiff::serializeDiff(buf, &m, &m1);
+    EXPECT_EQ(b, ContainerDiff::applyPatch(buf, 0, &m));
+    EXPECT_EQ(m, m1);
+
+    std::set<int> s{1, 2, 3, 4};
+    std::set<int> s1{2, 3, 4, 5, 6};
+    buf.clear();
+    b = ContainerDiff::serializeDiff(buf, &s, &s1);
+    EXPECT_EQ(b, 8 + sizeof(int) + 8 + 2 * sizeof(int));
+    EXPECT_EQ(b, ContainerDiff::applyPatch(buf, 0, &s));
+    EXPECT_EQ(s, s1);
+
+    // unchanged container gives empty patch
+    buf.clear();
+    b = ContainerDiff::serializeDiff(buf, &s, &s1);
+    EXPECT_EQ(b, 16);
+
+    std::vector<int> v(10000);
+    for(int i = 0; i < 10000; ++i) v[i] = i;
+    std::vector<int> v1 = v;
+    v1[10] = -1;
+    v1[12] = -1;        // gap of one element is joined to previous range
+    v1[5000] = -1;
+    v1.push_back(-2);
+    v1.push_back(-3);
+    buf.clear();
+    b = ContainerDiff::serializeDiff(buf, &v, &v1);
+    EXPECT_EQ(b, sizeof(size_t) + 8 + 3 * 16 + 3 * sizeof(int) + sizeof(int) + 2 * sizeof(int));
+    std::vector<int> vt = v;
+    EXPECT_EQ(b, ContainerDiff::applyPatch(buf, 0, &vt));
+    EXPECT_EQ(vt, v1);
+
+    // shrinking, and change that touches appended elements
+    std::deque<std::string> d{"a", "b", "c", "d"};
+    std::deque<std::string> d1{"a", "b"};
+    buf.clear();
+    ContainerDiff::serializeDiff(buf, &d, &d1);
+    ContainerDiff::applyPatch(buf, 0, &d);
+    EXPECT_EQ(d, d1);
+    d1.back() = "x";
+    d1.push_back("y");
+    std::deque<std::string> d2 = d;
+    buf.clear();
+    b = ContainerDiff::serializeDiff(buf, &d, &d1);
+    EXPECT_EQ(b, sizeof(size_t) + 8 + 16 + 2 * (8 + 1));
+    ContainerDiff::applyPatch(buf, 0, &d2);
+    EXPECT_EQ(d2, d1);
+
+    // broken patch
+    buf.resize(buf.size() - 1);
+    d2 = d;
+    EXPECT_THROW(ContainerDiff::applyPatch(buf, 0, &d2), SerializerExceptions::OutOfBounds);
+}
+
+TEST(FloatSeriesTest, SerializerTest)
+{
+    using namespace Serialization;
+
+    // slowly changing sensor data: values repeat, and change in a few low bits
+    std::vector<double> series(10000);
+    double value = 20.0;
+    for(size_t i = 0; i < series.size(); ++i)
+    {
+        if(i % 10 == 0) value += 0.25;
+        series[i] = value;
+    }
+    FloatSeriesWrapper fw(&series);
+    std::string buf;
+    BytesCount b = Serializer::serializeAll(buf, &fw);
+    EXPECT_EQ(b, buf.size());
+    EXPECT_LT(b * 5, series.size() * sizeof(double));
+
+    std::vector<double> series1;
+    FloatSeriesWrapper fw1(&series1);
+    EXPECT_EQ(b, Deserializer::deserializeAll(buf, 0, &fw1));
+    EXPECT_EQ(series, series1);
+
+    // values with noise, lossless and rounded
+    std::mt19937 rng(7);
+    std::normal_distribution<double> noise(0, 0.01);
+    for(double& v : series) v += noise(rng);
+    buf.clear();
+    BytesCount lossless = Serializer::serializeAll(buf, &fw);
+    EXPECT_EQ(lossless, Deserializer::deserializeAll(buf, 0, &fw1));
+    EXPECT_EQ(series, series1);
+
+    buf.clear();
+    FloatSeriesWrapper rounded(&series, 0.005);
+    b = Serializer::serializeAll(buf, &rounded);
+    EXPECT_LT(b * 3, lossless);
+    EXPECT_EQ(b, Deserializer::deserializeAll(buf, 0, &fw1));
+    ASSERT_EQ(series.size(), series1.size());
+    for(size_t i = 0; i < series.size(); ++i) EXPECT_LE(std::fabs(series[i] - series1[i]), 0.005);
+
+    // series with nan is written losslessly
+    std::vector<double> withNan{1.0, std::numeric_limits<double>::quiet_NaN(), 3.0};
+    FloatSeriesWrapper nanWrapper(&withNan, 0.1);
+    buf.clear();
+    Serializer::serializeAll(buf, &nanWrapper);
+    Deserializer::deserializeAll(buf, 0, &fw1);
+    EXPECT_EQ(fw1.cont->at(0), 1.0);
+    EXPECT_TRUE(std::isnan(fw1.cont->at(1)));
+    EXPECT_EQ(fw1.cont->at(2), 3.0);
+
+    // arrays of floats
+    float farr[100];
+    for(int i = 0; i < 100; ++i) farr[i] = 1.5f + (i / 7) * 0.5f;
+    ArrayWrapper<float> aw(farr, 100);
+    FloatSeriesWrapper faw(&aw);
+    buf.clear();
+    b = Serializer::serializeAll(buf, &faw);
+    EXPECT_LT(b, 100);
+    float farr1[100];
+    ArrayWrapper<float> aw1(farr1, 0, 100);
+    FloatSeriesWrapper faw1(&aw1);
+    EXPECT_EQ(b, Deserializer::deserializeAll(buf, 0, &faw1));
+    EXPECT_EQ(aw1.size, 100);
+    EXPECT_EQ(0, memcmp(farr, farr1, sizeof(farr)));
+    ArrayWrapper<float> small(farr1, 0, 10);
+    FloatSeriesWrapper fsmall(&small);
+    EXPECT_THROW(Deserializer::deserializeAll(buf, 0, &fsmall), SerializerExceptions::InvalidArgs);
+    OwningArrayWrapper<float> ow;
+    FloatSeriesWrapper fow(&ow);
+    Deserializer::deserializeAll(buf, 0, &fow);
+    EXPECT_EQ(0, memcmp(farr, ow.start, sizeof(farr)));
+
+    // truncated
+    buf.resize(buf.size() - 1);
+    EXPECT_THROW(Deserializer::deserializeAll(buf, 0, &faw1), SerializerExceptions::OutOfBounds);
+}
+
+TEST(PrecomputedHashTest, SerializerTest)
+{
+    using namespace Serialization;
+
+    PrecomputedHashMap<std::string, int, CountingHash> m;
+    for(int i = 0; i < 1000; ++i) m.emplace(std::string(100, 'k') + std::to_string(i), i);
+    EXPECT_EQ(CountingHash::calls, 1000);
+
+    std::string buf;
+    HashTableWrapper<PrecomputedHashMap<std::string, int, CountingHash>> hw(&m);
+    BytesCount b = Serializer::serializeAll(buf, &hw);
+    EXPECT_EQ(b, sizeof(ElementsCount) + sizeof(size_t) + 1000 * (sizeof(size_t) + sizeof(uint64_t) + sizeof(int)) + 1000 * 100 + 10 + 90 * 2 + 900 * 3);
+
+    PrecomputedHashMap<std::string, int, CountingHash> m1;
+    HashTableWrapper<PrecomputedHashMap<std::string, int, CountingHash>> hw1(&m1);
+    CountingHash::calls = 0;
+    EXPECT_EQ(b, Deserializer::deserializeAll(buf, 0, &hw1));
+    // one hash for default constructed temporary key
+    EXPECT_LE(CountingHash::calls, 1);
+    EXPECT_EQ(m, m1);
+    EXPECT_EQ(m.bucket_count(), m1.bucket_count());
+    EXPECT_EQ(m1.at(std::string(100, 'k') + "500"), 500);
+
+    // without wrapper it is ordinary container
+    PrecomputedHashSet<std::string> s{"neko", "wanko"};
+    buf.clear();
+    Serializer::serializeAll(buf, &s);
+    PrecomputedHashSet<std::string> s1;
+    Deserializer::deserializeAll(buf, 0, &s1);
+    EXPECT_EQ(s, s1);
+    EXPECT_EQ(s1.count("neko"), 1);
+
+    // corrupted bucket count doesn't allocate huge table
+    std::unordered_map<int, int> um{{1, 2}};
+    HashTableWrapper<std::unordered_map<int, int>> uw(&um);
+    buf.clear();
+    Serializer::serializeAll(buf, &uw);
+    ElementsCount huge = ElementsCount(1) << 40;
+    memcpy(&buf[0], &huge, sizeof(huge));
+    std::unordered_map<int, int> um1;
+    HashTableWrapper<std::unordered_map<int, int>> uw1(&um1);
+    Deserializer::deserializeAll(buf, 0, &uw1);
+    EXPECT_EQ(um, um1);
+    EXPECT_LT(um1.bucket_count(), 100);
+}
+
+TEST(ViewsTest, SerializerTest)
+{
+    using namespace Serialization;
+
+    std::vector<std::string> words{"neko", "wanko", "", "kitsune"};
+    std::map<std::string, int> m{{"one", 1}, {"two", 2}};
+    std::vector<double> vd{1.5, 2.5, 3.5};
+    std::string buf;
+    // array goes first, so it is aligned in buffer
+    Serializer::serializeAll(buf, &vd, &words, &m);
+
+    std::vector<std::string_view> words1;
+    std::map<std::string_view, int> m1;
+    ArrayView<double> vd1;
+    BytesCount b = Deserializer::deserializeAll(buf, 0, &vd1, &words1, &m1);
+    EXPECT_EQ(b, buf.size());
+    ASSERT_EQ(words1.size(), words.size());
+    for(size_t i = 0; i < words.size(); ++i) EXPECT_EQ(words[i], words1[i]);
+    // views point into buffer
+    EXPECT_GE(words1[0].data(), buf.data());
+    EXPECT_LT(words1[0].data(), buf.data() + buf.size());
+    EXPECT_EQ(m1.at("two"), 2);
+    ASSERT_EQ(vd1.size, 3);
+    EXPECT_EQ(vd1.start[2], 3.5);
+    EXPECT_EQ(reinterpret_cast<const char*>(vd1.start), buf.data() + sizeof(ElementsCount));
+
+    // views are written in the same format
+    std::string buf1;
+    Serializer::serializeAll(buf1, &vd1, &words1, &m1);
+    EXPECT_EQ(buf, buf1);
+
+    std::unordered_map<std::string_view, ArrayView<int>> um;
+    std::vector<int> vi{1, 2, 3};
+    um["ints"] = ArrayView<int>(vi.data(), vi.size());
+    buf.clear();
+    Serializer::serializeAll(buf, &um);
+    std::unordered_map<std::string_view, ArrayView<int>> um1;
+    Deserializer::deserializeAll(buf, 0, &um1);
+    EXPECT_EQ(um1.at("ints").size, 3);
+    EXPECT_EQ(um1.at("ints").start[1], 2);
+
+#if __cplusplus >= 202002L
+    std::span<const double> sd;
+    buf.clear();
+    Serializer::serializeAll(buf, &vd);
+    Deserializer::deserializeAll(buf, 0, &sd);
+    EXPECT_TRUE(std::equal(sd.begin(), sd.end(), vd.begin(), vd.end()));
+    std::span<double> sd1(vd);
+    buf1.clear();
+    Serializer::serializeAll(buf1, &sd1);
+    EXPECT_EQ(buf, buf1);
+#endif
+
+    // misaligned data can't be viewed
+    char c = 'c';
+    buf.clear();
+    Serializer::serializeAll(buf, &c, &vd);
+    EXPECT_THROW(Deserializer::deserializeAll(buf, 0, &c, &vd1), SerializerExceptions::InvalidArgs);
+    buf.resize(buf.size() - 1);
+    EXPECT_THROW(Deserializer::deserializeAll(buf, 1, &vd1), SerializerExceptions::OutOfBounds);
+}
+
+TEST(AlignedLayoutTest, SerializerTest)
+{
+    using namespace Serialization;
+
+    char c = 'c';
+    std::vector<double> embeddings(1000);
+    for(size_t i = 0; i < embeddings.size(); ++i) embeddings[i] = i * 0.5;
+    std::string name = "table";
+    std::vector<float> weights{1.f, 2.f, 3.f};
+    AlignedWrapper ae(&embeddings);
+    AlignedWrapper<std::vector<float>, 64> aw(&weights);
+
+    std::string buf;
+    BytesCount b = Serializer::serializeAll(buf, &c, &ae, &name, &aw);
+    EXPECT_EQ(b, buf.size());
+    // 1 + 8 + 1 = 10 bytes before padding of double array, 6 bytes of padding; float array starts at 8064
+    EXPECT_EQ(b, 1 + 8 + 1 + 6 + 1000 * 8 + 8 + 5 + 8 + 1 + 26 + 3 * 4);
+
+    char c1;
+    ArrayView<double> embeddings1;
+    AlignedWrapper ae1(&embeddings1);
+    std::string name1;
+    std::vector<float> weights1;
+    AlignedWrapper<std::vector<float>, 64> aw1(&weights1);
+    EXPECT_EQ(b, Deserializer::deserializeAll(buf, 0, &c1, &ae1, &name1, &aw1));
+    EXPECT_EQ(reinterpret_cast<const char*>(embeddings1.start), buf.data() + 16);
+    ASSERT_EQ(embeddings1.size, 1000);
+    EXPECT_EQ(embeddings1.start[999], 499.5);
+    EXPECT_EQ(weights, weights1);
+    EXPECT_EQ(name, name1);
+#if __cplusplus >= 202002L
+    std::span<const double> span;
+    AlignedWrapper as(&span);
+    Deserializer::deserializeAll(buf, 1, &as);
+    EXPECT_EQ(span.data(), embeddings1.start);
+#endif
+
+    // from mmapped file
+    std::string path = ::testing::TempDir() + "aligned_layout_test.bin";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out.write(buf.data(), buf.size());
+    }
+    {
+        MappedFile file(path);
+        ASSERT_EQ(file.size(), buf.size());
+        ArrayView<double> mapped;
+        EXPECT_EQ(8 + 1 + 6 + 1000 * 8, Deserializer::viewAligned(file.data(), file.size(), 1, &mapped));
+        EXPECT_EQ(reinterpret_cast<const char*>(mapped.start), file.data() + 16);
+        EXPECT_EQ(0, memcmp(mapped.start, embeddings.data(), 1000 * sizeof(double)));
+        ArrayView<float> mappedWeights;
+        Deserializer::viewAligned(file.data(), file.size(), 16 + 8000 + 13, &mappedWeights);
+        EXPECT_EQ((reinterpret_cast<const char*>(mappedWeights.start) - file.data()) % 64, 0);
+        EXPECT_EQ(mappedWeights.start[2], 3.f);
+        MappedFile moved = std::move(file);
+        EXPECT_EQ(file.data(), nullptr);
+        EXPECT_EQ(moved.size(), buf.size());
+    }
+    std::remove(path.c_str());
+    EXPECT_THROW(MappedFile{path}, SerializerExceptions::InvalidArgs);
+
+    // padding out of buffer
+    buf.resize(20);
+    buf[9] = char(200);
+    EXPECT_THROW(Deserializer::deserializeAll(buf, 0, &c1, &ae1), SerializerExceptions::OutOfBounds);
+}
+
+TEST(RecordLogTest, SerializerTest)
+{
+    using namespace Serialization;
+
+    std::string path = ::testing::TempDir() + "record_log_test.bin";
+    const int count = 10000;
+    {
+        RecordLogWriter writer(path, 100);
+        for(int i = 0; i < count; ++i)
+        {
+            std::string s(i % 50, 'a' + i % 26);
+            EXPECT_EQ(writer.append(&i, &s), i);
+        }
+        EXPECT_EQ(writer.size(), count);
+    }
+
+    RecordLogReader reader(path);
+    ASSERT_EQ(reader.size(), count);
+    for(int k : {0, 1, 99, 100, 5555, count - 1})
+    {
+        int i;
+        std::string s;
+        reader.read(k, &i, &s);
+        EXPECT_EQ(i, k);
+        EXPECT_EQ(s, std::string(k % 50, 'a' + k % 26));
+    }
+    EXPECT_THROW(reader.record(count), SerializerExceptions::OutOfBounds);
+
+    size_t next = 0;
+    reader.scan([&next](size_t index, std::string_view record)
+    {
+        int i;
+        memcpy(&i, record.data(), sizeof(i));
+        EXPECT_EQ(index, next++);
+        EXPECT_EQ(i, static_cast<int>(index));
+    });
+    EXPECT_EQ(next, count);
+
+    // more threads than blocks too
+    for(size_t threads : {1, 3, 4, 150})
+    {
+        std::vector<std::atomic<int>> seen(count);
+        reader.parallelScan([&seen](size_t index, std::string_view) { seen[index]++; }, threads);
+        EXPECT_TRUE(std::all_of(seen.begin(), seen.end(), [](const std::atomic<int>& n) { return n == 1; })) << threads;
+    }
+
+    // log that was not closed and is cut in the middle of record
+    std::string data;
+    {
+        MappedFile file(path);
+        data.assign(file.data(), file.size());
+    }
+    std::string cut = data.substr(0, data.size() / 2);
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(cut.data(), cut.size());
+    }
+    RecordLogReader partial(path);
+    EXPECT_GT(partial.size(), 0);
+    EXPECT_LT(partial.size(), count);
+    size_t scanned = 0;
+    partial.parallelScan([&scanned](size_t, std::string_view) { ++scanned; }, 1);
+    EXPECT_EQ(scanned, partial.size());
+    int last;
+    partial.read(partial.size() - 1, &last);
+    EXPECT_EQ(last, static_cast<int>(partial.size()) - 1);
+
+    std::remove(path.c_str());
+    EXPECT_THROW(RecordLogReader{path}, SerializerExceptions::InvalidArgs);
+
+    // write errors are reported by flush() and close()
+    if(std::ifstream("/dev/full"))
+    {
+        RecordLogWriter full("/dev/full");
+        int i = 5;
+        full.append(&i);
+        EXPECT_THROW(full.flush(), SerializerExceptions::InvalidArgs);
+        EXPECT_THROW(full.close(), SerializerExceptions::InvalidArgs);
+        EXPECT_THROW(full.append(&i), SerializerExceptions::InvalidArgs);
+    }
+}
+
+template<>
+struct Serialization::Scanner::ScanUnit<User> : Serialization::Scanner::ScanLayout<std::string, int, std::vector<std::string>> {};
+
+TEST(ScanTest, SerializerTest)
+{
+    using namespace Serialization;
+
+    std::vector<int> numbers(1000, 7);
+    std::vector<std::string> words{"short", std::string(100, 'x'), ""};
+    std::map<int, std::string> names{{1, "one"}, {2, "two"}};
+    std::list<double> doubles{1.5, 2.5};
+    std::vector<uint32_t> small{1, 300, 70000};
+    VarintWrapper<uint32_t> varints{&small};
+    User user;
+    user.name = "Ann";
+    user.age = 30;
+    user.hobbies = {"chess"};
+
+    std::string buf;
+    BytesCount written = Serializer::serializeAll(buf, &numbers, &words, &names, &doubles, &varints, &user);
+    ScanResult result = Scanner::scan<std::vector<int>, std::vector<std::string>, std::map<int, std::string>, std::list<double>, VarintWrapper<uint32_t>, User>(buf);
+    EXPECT_EQ(result.bytes, written);
+    EXPECT_EQ(result.elements, 1000 + 3 + 2 + 2 + 3 + 1);
+    BytesCount expectedHeap = 1000 * sizeof(int) + 3 * sizeof(std::string) + 101 + 2 * (sizeof(std::pair<const int, std::string>) + 4 * sizeof(void*)) +
+        2 * (sizeof(double) + 2 * sizeof(void*)) + 3 * sizeof(uint32_t) + sizeof(std::string);
+    EXPECT_EQ(result.heapBytes, expectedHeap);
+    EXPECT_EQ(result.allocations, 1 + 1 + 1 + 2 + 2 + 1 + 1);
+
+    // scanning from offset and from memory that is not std::string
+    BytesCount userOffset = written - Serializer::serializeAll(buf, &user);
+    buf.resize(written);
+    EXPECT_EQ(Scanner::scan<User>(std::string_view(buf.data(), buf.size()), userOffset).bytes, written - userOffset);
+
+    // every truncation is detected
+    for(BytesCount size = 0; size < written; ++size)
+    {
+        std::string_view cut(buf.data(), size);
+        EXPECT_THROW((Scanner::scan<std::vector<int>, std::vector<std::string>, std::map<int, std::string>, std::list<double>, VarintWrapper<uint32_t>, User>(cut)),
+            SerializerExceptions::OutOfBounds);
+    }
+
+    // corrupted count is rejected before anything is allocated
+    std::string corrupted = buf;
+    size_t hugeCount = SIZE_MAX / 2;
+    memcpy(&corrupted[0], &hugeCount, sizeof(hugeCount));
+    EXPECT_THROW(Scanner::scan<std::vector<int>>(corrupted), SerializerExceptions::OutOfBounds);
+    EXPECT_THROW(Scanner::scan<std::vector<std::vector<int>>>(corrupted), SerializerExceptions::OutOfBounds);
+}
+
+TEST(BatchDecodeTest, SerializerTest)
+{
+    using namespace Serialization;
+
+    // uneven sizes: every 100th message is big
+    const int count = 2000;
+    std::vector<std::string> buffers(count);
+    std::string frames;
+    std::vector<std::pair<size_t, size_t>> frameBounds;
+    for(int i = 0; i < count; ++i)
+    {
+        User user;
+        user.name = "user" + std::to_string(i);
+        user.age = i;
+        user.hobbies.assign(i % 100 == 0 ? 1000 : i % 5, "hobby");
+        Serializer::serializeAll(buffers[i], &user);
+        frameBounds.emplace_back(frames.size(), buffers[i].size());
+        frames += buffers[i];
+    }
+    buffers[7].resize(buffers[7].size() / 2);
+
+    BatchDecoder decoder(4);
+    EXPECT_EQ(decoder.getThreadsCount(), 4);
+    std::vector<User> users;
+    for(int pass = 0; pass < 2; ++pass)
+    {
+        std::vector<BatchDecoder::Result> results = decoder.decode(buffers, users);
+        ASSERT_EQ(users.size(), count);
+        ASSERT_EQ(results.size(), count);
+        for(int i = 0; i < count; ++i)
+        {
+            if(i == 7)
+            {
+                EXPECT_FALSE(results[i].ok());
+                EXPECT_THROW(std::rethrow_exception(results[i].error), SerializerExceptions::OutOfBounds);
+                continue;
+            }
+            ASSERT_TRUE(results[i].ok());
+            EXPECT_EQ(results[i].bytes, buffers[i].size());
+            EXPECT_EQ(users[i].age, i);
+            EXPECT_EQ(users[i].name, "user" + std::to_string(i));
+            EXPECT_EQ(users[i].hobbies.size(), i % 100 == 0 ? 1000u : size_t(i % 5));
+        }
+    }
+
+    // frames pointing into one big buffer
+    std::vector<std::string_view> views;
+    for(auto& bounds : frameBounds) views.emplace_back(frames.data() + bounds.first, bounds.second);
+    std::vector<User> fromFrames;
+    std::vector<BatchDecoder::Result> results = BatchDecoder(1).decode(views, fromFrames);
+    EXPECT_TRUE(std::all_of(results.begin(), results.end(), [](const BatchDecoder::Result& r) { return r.ok(); }));
+    EXPECT_EQ(fromFrames[count - 1].name, "user" + std::to_string(count - 1));
+    EXPECT_TRUE(decoder.decode(std::vector<std::string>{}, fromFrames).empty());
+
+    // targets left over from bigger batch are kept in context of worker and reused by the next bigger batch
+    BatchDecoder single(1);
+    std::vector<std::string> texts{std::string(100, 'a'), std::string(100, 'b'), std::string(100, 'c')};
+    std::vector<std::string> encoded(texts.size());
+    for(size_t i = 0; i < texts.size(); ++i) Serializer::serializeAll(encoded[i], &texts[i]);
+    std::vector<std::string> decodedTexts;
+    single.decode(encoded, decodedTexts);
+    const char* memory = decodedTexts[2].data();
+    single.decode(std::vector<std::string>(encoded.begin(), encoded.begin() + 2), decodedTexts);
+    EXPECT_EQ(decodedTexts.size(), 2);
+    single.decode(encoded, decodedTexts);
+    EXPECT_EQ(decodedTexts, texts);
+    EXPECT_EQ(decodedTexts[2].data(), memory);
+
+    // concurrent calls share one pool, they are decoded one after another
+    std::vector<std::thread> callers;
+    std::vector<int> correct(4, 1);
+    for(size_t c = 0; c < correct.size(); ++c)
+    {
+        callers.emplace_back([&, c]()
+        {
+            std::vector<std::string> own;
+            for(int k = 0; k < 20; ++k)
+            {
+                size_t n = (k + c) % encoded.size() + 1;
+                decoder.decode(std::vector<std::string>(encoded.begin(), encoded.begin() + n), own);
+                correct[c] = correct[c] && own == std::vector<std::string>(texts.begin(), texts.begin() + n);
+            }
+        });
+    }
+    for(auto& t : callers) t.join();
+    EXPECT_EQ(correct, std::vector<int>(correct.size(), 1));
+}
+
+struct CountedUser : public User
+{
+    int serializations = 0;
+
+    S::BytesCount serialize(std::string &buf)
+    {
+        ++serializations;
+        return User::serialize(buf);
+    }
+};
+
+TEST(CachedSerializableTest, SerializerTest)
+{
+    using namespace Serialization;
+
+    CachedSerializable<CountedUser> user;
+    user.name = "Ann";
+    user.age = 30;
+    user.hobbies = {"chess", "go"};
+    std::string expected;
+    Serializer::serializeAll(expected, static_cast<User*>(&user));
+
+    std::string buf;
+    for(int i = 0; i < 3; ++i) Serializer::serializeAll(buf, &user);
+    EXPECT_EQ(buf, expected + expected + expected);
+    EXPECT_EQ(user.serializations, 1);
+    EXPECT_TRUE(user.isCached());
+
+    user.modify().age = 31;
+    EXPECT_FALSE(user.isCached());
+    buf.clear();
+    Serializer::serializeAll(buf, &user);
+    EXPECT_EQ(user.serializations, 2);
+    User decoded;
+    Deserializer::deserializeAll(buf, 0, &decoded);
+    EXPECT_EQ(decoded.age, 31);
+
+    // deserialization drops cache
+    CachedSerializable<CountedUser> copy;
+    Serializer::serializeAll(buf, &copy);
+    Deserializer::deserializeAll(buf, 0, &copy);
+    EXPECT_FALSE(copy.isCached());
+    EXPECT_EQ(copy.age, 31);
+
+    // copies share cached bytes
+    Serializer::serializeAll(buf, &user);
+    CachedSerializable<CountedUser> copied = user;
+    EXPECT_TRUE(copied.isCached());
+    copy = user;
+    EXPECT_TRUE(copy.isCached());
+
+    // elements of containers are cached one by one
+    std::vector<CachedSerializable<CountedUser>> users(10);
+    for(auto& u : users) u.name = "user";
+    std::string first, second;
+    Serializer::serializeAll(first, &users);
+    users[3].modify().age = 3;
+    Serializer::serializeAll(second, &users);
+    EXPECT_EQ(users[0].serializations, 1);
+    EXPECT_EQ(users[3].serializations, 2);
+    std::vector<User> plain;
+    Deserializer::deserializeAll(second, 0, &plain);
+    EXPECT_EQ(plain[3].age, 3);
+    EXPECT_EQ(plain[9].name, "user");
+
+    // unchanged object is serialized from several threads at once
+    CachedSerializable<User> shared;
+    shared.name = "broadcast";
+    shared.hobbies = {"a", "b"};
+    std::string sharedExpected;
+    Serializer::serializeAll(sharedExpected, static_cast<User*>(&shared));
+    std::vector<std::thread> senders;
+    std::atomic<int> mismatches{0};
+    for(int t = 0; t < 4; ++t)
+    {
+        senders.emplace_back([&shared, &sharedExpected, &mismatches]()
+        {
+            for(int i = 0; i < 1000; ++i)
+            {
+                std::string out;
+                Serializer::serializeAll(out, &shared);
+                if(out != sharedExpected) ++mismatches;
+            }
+        });
+    }
+    for(auto& t : senders) t.join();
+    EXPECT_EQ(mismatches, 0);
+    EXPECT_TRUE(shared.isCached());
+
+    // cache of multiple serializers is bound to serializer id
+    CachedSerializable<Cat> cat;
+    cat.name = "Tom";
+    cat.legs = 4;
+    cat.age = 2;
+    cat.places_to_sleep = {"sofa"};
+    cat.setSerializerId(Cat::NameLegsSerializer);
+    std::string short1, full;
+    BytesCount shortSize = Serializer::serializeAll(short1, &cat);
+    cat.setSerializerId(Cat::AllSerializer);
+    BytesCount fullSize = Serializer::serializeAll(full, &cat);
+    EXPECT_GT(fullSize, shortSize);
+    Cat decodedCat;
+    decodedCat.setDeserializerId(Cat::AllDeserializer);
+    Deserializer::deserializeAll(full, 0, &decodedCat);
+    EXPECT_EQ(decodedCat.places_to_sleep, cat.places_to_sleep);
+}
+
+TEST(FlatContainersTest, SerializerTest)
+{
+    using namespace Serialization;
+
+    // the same format as std containers
+    std::map<int, std::string> m{{3, "three"}, {1, "one"}, {2, "two"}};
+    std::set<std::string> s{"b", "a", "c"};
+    std::unordered_map<int, std::string> um;
+    for(int i = 0; i < 1000; ++i) um[i * 7] = std::to_string(i);
+    std::string buf;
+    Serializer::serializeAll(buf, &m, &s, &um, &um);
+
+    FlatMap<int, std::string> fm;
+    FlatSet<std::string> fs;
+    FlatHashMap<int, std::string> fhm;
+    // unordered data is sorted on load
+    FlatMap<int, std::string> sortedFromUnordered;
+    BytesCount read = Deserializer::deserializeAll(buf, 0, &fm, &fs, &fhm, &sortedFromUnordered);
+    EXPECT_EQ(read, buf.size());
+    EXPECT_TRUE(areContainersEqual(fm, FlatMap<int, std::string>{{1, "one"}, {2, "two"}, {3, "three"}}));
+    EXPECT_EQ(fm.at(2), "two");
+    EXPECT_EQ(fm.count(4), 0);
+    EXPECT_TRUE(areContainersEqual(fs, FlatSet<std::string>{"a", "b", "c"}));
+    EXPECT_EQ(fhm.size(), um.size());
+    for(auto& kv : um) EXPECT_EQ(fhm.at(kv.first), kv.second);
+    EXPECT_EQ(fhm.find(1), fhm.end());
+    EXPECT_EQ(sortedFromUnordered.size(), um.size());
+    EXPECT_TRUE(std::is_sorted(sortedFromUnordered.begin(), sortedFromUnordered.end()));
+    EXPECT_EQ(sortedFromUnordered.at(700), "100");
+
+    // and back to std containers
+    buf.clear();
+    Serializer::serializeAll(buf, &fm, &fs, &fhm);
+    std::map<int, std::string> m2;
+    std::set<std::string> s2;
+    std::unordered_map<int, std::string> um2;
+    Deserializer::deserializeAll(buf, 0, &m2, &s2, &um2);
+    EXPECT_EQ(m2, m);
+    EXPECT_EQ(s2, s);
+    EXPECT_EQ(um2, um);
+
+    // duplicate keys keep the first value, as std::map does
+    std::vector<std::pair<int, int>> pairs{{2, 20}, {1, 10}, {2, 21}};
+    buf.clear();
+    Serializer::serializeAll(buf, &pairs);
+    FlatMap<int, int> dups;
+    Deserializer::deserializeAll(buf, 0, &dups);
+    EXPECT_TRUE(areContainersEqual(dups, FlatMap<int, int>{{1, 10}, {2, 20}}));
+
+    // modification
+    fm[0] = "zero";
+    fm.erase(3);
+    EXPECT_TRUE(areContainersEqual(fm, FlatMap<int, std::string>{{0, "zero"}, {1, "one"}, {2, "two"}}));
+    for(int i = 0; i < 1000; i += 2) EXPECT_EQ(fhm.erase(i * 7), 1);
+    EXPECT_EQ(fhm.erase(0), 0);
+    EXPECT_EQ(fhm.size(), 500);
+    for(int i = 1; i < 1000; i += 2) EXPECT_EQ(fhm.at(i * 7), std::to_string(i));
+    fhm[5] = "five";
+    EXPECT_TRUE(fhm.insert({5, "other"}).second == false);
+    EXPECT_EQ(fhm.at(5), "five");
+    // corrupted count doesn't reserve memory for elements that are not in buffer
+    buf.clear();
+    size_t hugeCount = size_t(1) << 40;
+    int key = 1, value = 2;
+    Serializer::serializeAll(buf, &hugeCount, &key, &value);
+    FlatHashMap<int, int> corrupted;
+    FlatSet<std::string> corruptedSet;
+    EXPECT_THROW(Deserializer::deserializeAll(buf, 0, &corrupted), SerializerExceptions::OutOfBounds);
+    EXPECT_THROW(Deserializer::deserializeAll(buf, 0, &corruptedSet), SerializerExceptions::OutOfBounds);
+    EXPECT_LE(corrupted.bucket_count(), 16);
+    EXPECT_EQ(corruptedSet.capacity(), 0);
+}
+
+TEST(FixedRunsTest, SerializerTest)
+{
+    using namespace Serialization;
+
+    static_assert(FixedRuns<int, double, std::string, char>::runEnd(0) == 2);
+    static_assert(FixedRuns<int, double, std::string, char>::runEnd(2) == 2);
+    static_assert(FixedRuns<int, double, std::string, char>::bytes(0, 2) == sizeof(int) + sizeof(double));
+    static_assert(FixedSerializedSize<std::pair<const int, short>>::value == sizeof(int) + sizeof(short));
+    static_assert(FixedSerializedSize<std::pair<int, std::string>>::value == 0);
+
+    int a = -5;
+    double b = 2.5;
+    std::pair<int, char> c{7, 'c'};
+    std::string d = "between";
+    bool e = true;
+    uint64_t f = 1ull << 40;
+    std::string buf;
+    BytesCount written = Serializer::serializeAll(buf, &a, &b, &c, &d, &e, &f);
+    EXPECT_EQ(written, buf.size());
+
+    // the same bytes as arguments written one by one
+    std::string expected;
+    Serializer::serializeAll(expected, &a);
+    Serializer::serializeAll(expected, &b);
+    Serializer::serializeAll(expected, &c);
+    Serializer::serializeAll(expected, &d);
+    Serializer::serializeAll(expected, &e);
+    Serializer::serializeAll(expected, &f);
+    EXPECT_EQ(buf, expected);
+
+    int a2;
+    double b2;
+    std::pair<int, char> c2;
+    std::string d2;
+    bool e2;
+    uint64_t f2;
+    EXPECT_EQ(Deserializer::deserializeAll(buf, 0, &a2, &b2, &c2, &d2, &e2, &f2), written);
+    EXPECT_EQ(a2, a);
+    EXPECT_EQ(b2, b);
+    EXPECT_EQ(c2, c);
+    EXPECT_EQ(d2, d);
+    EXPECT_EQ(e2, e);
+    EXPECT_EQ(f2, f);
+
+    // group is checked as a whole
+    for(BytesCount size = 0; size < written; ++size)
+    {
+        EXPECT_THROW(Deserializer::deserializeAll(buf.substr(0, size), 0, &a2, &b2, &c2, &d2, &e2, &f2), SerializerExceptions::OutOfBounds);
+    }
+}